@@ -13,9 +13,423 @@ int btnState_2 = 0;
 int valor;
 int valor_0;
 
+// Time (millis) when a held button sends its command again
+unsigned long btnRepeat_1 = 0;
+unsigned long btnRepeat_2 = 0;
+
+// Led frame protocol (must match include/LedProtocol.h)
+// | magic (2) | version (1) | type (1) | length (2) | seq (1) | payload | crc16 (2) |
+const byte LED_FRAME_MAGIC_0 = 0xA5;
+const byte LED_FRAME_MAGIC_1 = 0x5A;
+const byte LED_FRAME_VERSION = 1;
+const byte LED_FRAME_FULL = 0x01;
+const byte LED_FRAME_RLE_FULL = 0x02;
+const byte LED_FRAME_DELTA = 0x03;
+const byte LED_FRAME_FULL_565 = 0x04;
+const byte LED_FRAME_PALETTE = 0x05;
+const byte LED_SPAN_RUN_BIT = 0x80;
+const byte FRAME_HELLO = 0x10;
+const byte FRAME_SET_BAUD = 0x11;
+const byte FRAME_COMMAND_IDS = 0x12;
+
+// Sram: the led frames are decoded into leds as they stream in (an uno / nano has 2 KB, the leds alone take 1323 B)
+// and only the small control frames are staged until their crc is checked, the palette frames need room for 256
+// colors more so they are only supported on boards with more sram (mega 2560 and up)
+#if defined(RAMEND) && RAMEND < 0x1000
+#define LED_PALETTE_SUPPORT 0
+#else
+#define LED_PALETTE_SUPPORT 1
+#endif
+
+// Supported frame types (bit = frame type) reported in the capabilities
+const unsigned long SUPPORTED_ENCODINGS = (1UL << LED_FRAME_FULL) | (1UL << LED_FRAME_RLE_FULL) | (1UL << LED_FRAME_DELTA) | (1UL << LED_FRAME_FULL_565) | (LED_PALETTE_SUPPORT ? (1UL << LED_FRAME_PALETTE) : 0) | (1UL << FRAME_COMMAND_IDS);
+
+// Commands sent to the host, by name or as #<id> once the host asks for the ids
+enum Command {
+  CMD_COMANDO1,
+  CMD_COMANDO2,
+  CMD_SUBIR,
+  CMD_BAJAR,
+  NUM_COMMANDS
+};
+
+const char* const COMMAND_NAMES[NUM_COMMANDS] = { "Comando1", "Comando2", "Subir", "Bajar" };
+
+// Baud rates: every connection starts at the base one and the host can raise it up to the max
+const unsigned long BASE_BAUD = 9600;
+const unsigned long MAX_BAUD = 1000000;
+const unsigned long LINK_TIMEOUT_MS = 3000; // back to the base baud if no valid frame arrives in this time
+const unsigned long KNOB_POLL_MS = 5;
+const unsigned long BUTTON_REPEAT_MS = 150; // a held button repeats its command at this interval
+
+const int NUM_LEDS = 441; // has to match the wired leds of the led_geometry of the host config
+const unsigned int LED_FRAME_MAX_PAYLOAD = NUM_LEDS * 3;
+const unsigned int CONTROL_FRAME_MAX_PAYLOAD = 4;
+
+enum FrameState {
+  WAIT_MAGIC_0,
+  WAIT_MAGIC_1,
+  READ_HEADER,
+  READ_PAYLOAD,
+  READ_CRC
+};
+
+// Position in the spans of a rle or delta payload
+enum SpanState {
+  SPAN_SKIP_0,
+  SPAN_SKIP_1,
+  SPAN_OP,
+  SPAN_DATA
+};
+
+byte leds[NUM_LEDS * 3]; // rgb of every led
+byte controlPayload[CONTROL_FRAME_MAX_PAYLOAD]; // control frames are staged until the crc is checked
+
+#if LED_PALETTE_SUPPORT
+byte palette[256 * 3];
+#endif
+
+FrameState frameState = WAIT_MAGIC_0;
+byte frameHeader[5]; // version, type, length (2), seq
+int frameHeaderPos = 0;
+unsigned int frameLength = 0;
+unsigned int framePos = 0;
+uint16_t frameCrc = 0;
+byte frameCrcBytes[2];
+int frameCrcPos = 0;
+byte lastFrameSeq = 0;
+bool hasFrame = false; // deltas are ignored until the first keyframe
+unsigned long droppedFrames = 0;
+
+// Streaming decode of the led frame being received
+bool ledFrameFailed = false; // the rest of the payload is ignored and the frame is dropped
+bool ledsTouched = false; // the frame wrote into leds, if it's dropped they no longer match any frame of the host
+SpanState spanState = SPAN_SKIP_0;
+unsigned int spanLed = 0;
+unsigned int spanCount = 0;
+byte spanOp = 0;
+byte spanSkipLow = 0;
+byte decodeColor[3];
+byte decodeColorPos = 0;
+unsigned int paletteSize = 0;
+
+unsigned long currentBaud = BASE_BAUD;
+unsigned long lastValidFrameMillis = 0;
+unsigned long lastKnobPollMillis = 0;
+bool commandIds = false; // commands are sent as #<id> (asked by the host)
+
+uint16_t crc16Update(uint16_t crc, byte data) {
+  crc ^= (uint16_t)data << 8;
+  for (int i = 0; i < 8; i++) {
+    crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : (crc << 1);
+  }
+  return crc;
+}
+
+bool isLedFrame(byte type) {
+  return type == LED_FRAME_FULL || type == LED_FRAME_RLE_FULL || type == LED_FRAME_DELTA || type == LED_FRAME_FULL_565 || (LED_PALETTE_SUPPORT && type == LED_FRAME_PALETTE);
+}
+
+// Check the length of a frame from its header and reset the decode, returns false if the frame can't be received
+bool beginFrame(byte type) {
+  ledFrameFailed = false;
+  ledsTouched = false;
+  spanState = SPAN_SKIP_0;
+  spanLed = 0;
+  decodeColorPos = 0;
+
+  if (!isLedFrame(type)) {
+    return frameLength <= CONTROL_FRAME_MAX_PAYLOAD;
+  }
+  if (type == LED_FRAME_FULL) {
+    return frameLength == NUM_LEDS * 3;
+  }
+  if (type == LED_FRAME_FULL_565) {
+    return frameLength == NUM_LEDS * 2;
+  }
+  if (type == LED_FRAME_DELTA || type == LED_FRAME_PALETTE) {
+    return frameLength >= 1 && frameLength <= LED_FRAME_MAX_PAYLOAD;
+  }
+  return frameLength <= LED_FRAME_MAX_PAYLOAD;
+}
+
+// Decode one byte of the spans of a rle or delta payload on top of the current leds
+// | skip (2) | op (1) | data |, op bit 7 = run of one color, otherwise literal colors
+bool decodeSpanByte(byte data) {
+  switch (spanState) {
+    case SPAN_SKIP_0:
+      spanSkipLow = data;
+      spanState = SPAN_SKIP_1;
+      return true;
+
+    case SPAN_SKIP_1:
+      spanLed += spanSkipLow | ((unsigned int)data << 8);
+      spanState = SPAN_OP;
+      return true;
+
+    case SPAN_OP:
+      spanOp = data;
+      spanCount = (data & 0x7F) + 1;
+      if (spanLed + spanCount > NUM_LEDS) {
+        return false;
+      }
+      decodeColorPos = 0;
+      spanState = SPAN_DATA;
+      return true;
+
+    case SPAN_DATA:
+      ledsTouched = true;
+      if (spanOp & LED_SPAN_RUN_BIT) {
+        decodeColor[decodeColorPos++] = data;
+        if (decodeColorPos == 3) {
+          for (unsigned int i = 0; i < spanCount; i++) {
+            memcpy(&leds[(spanLed + i) * 3], decodeColor, 3);
+          }
+          spanLed += spanCount;
+          spanState = SPAN_SKIP_0;
+        }
+      } else {
+        leds[spanLed * 3 + decodeColorPos++] = data;
+        if (decodeColorPos == 3) {
+          decodeColorPos = 0;
+          spanLed++;
+          if (--spanCount == 0) {
+            spanState = SPAN_SKIP_0;
+          }
+        }
+      }
+      return true;
+  }
+  return false;
+}
+
+// Decode the payload byte at framePos of a led frame straight into the leds, returns false if the frame can't be
+// applied to the current leds
+bool decodeLedByte(byte type, byte seq, byte data) {
+  if (type == LED_FRAME_FULL) {
+    ledsTouched = true;
+    leds[framePos] = data;
+    return true;
+  }
+  if (type == LED_FRAME_FULL_565) {
+    if ((framePos & 1) == 0) {
+      decodeColor[0] = data;
+      return true;
+    }
+    ledsTouched = true;
+    unsigned int color = decodeColor[0] | ((unsigned int)data << 8);
+    unsigned int led = framePos / 2;
+    byte r = (color >> 8) & 0xF8;
+    byte g = (color >> 3) & 0xFC;
+    byte b = (color << 3) & 0xF8;
+    leds[led * 3] = r | (r >> 5);
+    leds[led * 3 + 1] = g | (g >> 6);
+    leds[led * 3 + 2] = b | (b >> 5);
+    return true;
+  }
+#if LED_PALETTE_SUPPORT
+  if (type == LED_FRAME_PALETTE) {
+    // | palette size - 1 (1) | palette rgb | one index per led |
+    if (framePos == 0) {
+      paletteSize = (unsigned int)data + 1;
+      return frameLength == 1 + paletteSize * 3 + NUM_LEDS;
+    }
+    if (framePos < 1 + paletteSize * 3) {
+      palette[framePos - 1] = data;
+      return true;
+    }
+    if (data >= paletteSize) {
+      return false;
+    }
+    ledsTouched = true;
+    memcpy(&leds[(framePos - 1 - paletteSize * 3) * 3], &palette[data * 3], 3);
+    return true;
+  }
+#endif
+  if (type == LED_FRAME_DELTA && framePos == 0) {
+    // The delta covers every frame sent after its base, so it is valid if the
+    // current leds are the base frame or any newer frame before this one
+    return hasFrame && (signed char)(lastFrameSeq - data) >= 0 && (signed char)(seq - lastFrameSeq) > 0;
+  }
+  return decodeSpanByte(data);
+}
+
+// Send an input event stamped with the time it was detected: <command>\t<micros> or #<id>\t<micros>
+void sendEvent(byte command, unsigned long timestamp) {
+  if (commandIds) {
+    Serial.print("#");
+    Serial.print(command);
+  } else {
+    Serial.print(COMMAND_NAMES[command]);
+  }
+  Serial.print("\t");
+  Serial.println(timestamp);
+}
+
+// Send the command on the press and then every BUTTON_REPEAT_MS while held
+void updateButton(int btnPin, int ledPin, int& btnState, unsigned long& btnRepeat, byte command) {
+  unsigned long timestamp = micros();
+  int state = digitalRead(btnPin);
+
+  if (state == HIGH && (btnState == LOW || (long)(millis() - btnRepeat) >= 0)) {
+    sendEvent(command, timestamp);
+    btnRepeat = millis() + BUTTON_REPEAT_MS;
+  }
+
+  if (state != btnState) {
+    digitalWrite(ledPin, state);
+    btnState = state;
+  }
+}
+
+void switchBaud(unsigned long baud) {
+  // Let the last line go out at the old rate before switching
+  Serial.flush();
+  Serial.end();
+  Serial.begin(baud);
+  currentBaud = baud;
+  frameState = WAIT_MAGIC_0;
+  lastValidFrameMillis = millis();
+}
+
+// A led frame that wrote part of its payload leaves leds that no deltas can be applied to, until the next keyframe
+void dropLedFrame() {
+  droppedFrames++;
+  if (ledsTouched) {
+    hasFrame = false;
+  }
+}
+
+void handleFrame(byte type, byte seq) {
+  if (type == FRAME_HELLO) {
+    // CAPS <num leds> <supported encodings> <max baud> <micros> <hello seq>, the time lets the host estimate the
+    // clock offset and the seq tells it which hello this answers
+    unsigned long now = micros();
+    Serial.print("CAPS ");
+    Serial.print((unsigned long)NUM_LEDS);
+    Serial.print(" ");
+    Serial.print(SUPPORTED_ENCODINGS);
+    Serial.print(" ");
+    Serial.print(MAX_BAUD);
+    Serial.print(" ");
+    Serial.print(now);
+    Serial.print(" ");
+    Serial.println(seq);
+    return;
+  }
+  if (type == FRAME_COMMAND_IDS) {
+    // CMDS <id> <name> ..., every command is sent as #<id> from now on
+    Serial.print("CMDS");
+    for (byte i = 0; i < NUM_COMMANDS; i++) {
+      Serial.print(" ");
+      Serial.print(i);
+      Serial.print(" ");
+      Serial.print(COMMAND_NAMES[i]);
+    }
+    Serial.println();
+    commandIds = true;
+    return;
+  }
+  if (type == FRAME_SET_BAUD) {
+    if (frameLength != 4) {
+      return;
+    }
+    unsigned long baud = (unsigned long)controlPayload[0] | ((unsigned long)controlPayload[1] << 8) | ((unsigned long)controlPayload[2] << 16) | ((unsigned long)controlPayload[3] << 24);
+    if (baud < BASE_BAUD || baud > MAX_BAUD) {
+      return;
+    }
+    Serial.print("BAUD ");
+    Serial.println(baud);
+    switchBaud(baud);
+    return;
+  }
+  if (!isLedFrame(type)) {
+    return;
+  }
+  // The payload is already decoded, a rle or delta frame is complete if it didn't stop in the middle of a span
+  bool complete = (type != LED_FRAME_RLE_FULL && type != LED_FRAME_DELTA) || spanState == SPAN_SKIP_0;
+  if (!ledFrameFailed && complete) {
+    // Acknowledge the frame so the host can use it as the delta base
+    lastFrameSeq = seq;
+    hasFrame = true;
+    Serial.print("ACK ");
+    Serial.println(lastFrameSeq);
+  } else {
+    dropLedFrame();
+  }
+}
+
+// Feed one received byte to the frame parser, a corrupted frame is dropped and the parser
+// waits for the next magic so a lost byte only costs that frame (and the deltas until the next keyframe if it was
+// already decoded into the leds)
+void parseLedFrameByte(byte data) {
+  switch (frameState) {
+    case WAIT_MAGIC_0:
+      if (data == LED_FRAME_MAGIC_0) {
+        frameState = WAIT_MAGIC_1;
+      }
+      break;
+
+    case WAIT_MAGIC_1:
+      if (data == LED_FRAME_MAGIC_1) {
+        frameState = READ_HEADER;
+        frameHeaderPos = 0;
+        frameCrc = 0xFFFF;
+      } else if (data != LED_FRAME_MAGIC_0) {
+        frameState = WAIT_MAGIC_0;
+      }
+      break;
+
+    case READ_HEADER:
+      frameHeader[frameHeaderPos++] = data;
+      frameCrc = crc16Update(frameCrc, data);
+      if (frameHeaderPos == 5) {
+        frameLength = frameHeader[2] | ((unsigned int)frameHeader[3] << 8);
+        framePos = 0;
+        frameCrcPos = 0;
+        if (frameHeader[0] != LED_FRAME_VERSION || !beginFrame(frameHeader[1])) {
+          droppedFrames++;
+          frameState = WAIT_MAGIC_0;
+        } else {
+          frameState = frameLength > 0 ? READ_PAYLOAD : READ_CRC;
+        }
+      }
+      break;
+
+    case READ_PAYLOAD:
+      if (!isLedFrame(frameHeader[1])) {
+        controlPayload[framePos] = data;
+      } else if (!ledFrameFailed && !decodeLedByte(frameHeader[1], frameHeader[4], data)) {
+        ledFrameFailed = true;
+      }
+      framePos++;
+      frameCrc = crc16Update(frameCrc, data);
+      if (framePos == frameLength) {
+        frameState = READ_CRC;
+      }
+      break;
+
+    case READ_CRC:
+      frameCrcBytes[frameCrcPos++] = data;
+      if (frameCrcPos == 2) {
+        uint16_t receivedCrc = frameCrcBytes[0] | ((unsigned int)frameCrcBytes[1] << 8);
+        if (receivedCrc == frameCrc) {
+          lastValidFrameMillis = millis();
+          handleFrame(frameHeader[1], frameHeader[4]);
+        } else if (isLedFrame(frameHeader[1])) {
+          dropLedFrame();
+        } else {
+          droppedFrames++;
+        }
+        frameState = WAIT_MAGIC_0;
+      }
+      break;
+  }
+}
+
 void setup() {
   // put your setup code here, to run once:
-  Serial.begin(9600); // set baud rate to math the communication rate with the program
+  Serial.begin(BASE_BAUD); // set baud rate to math the communication rate with the program (the host can raise it later)
   pinMode(btnPin_1, INPUT);
   pinMode(btnPin_2, INPUT);
   pinMode(ledPin_1, OUTPUT);
@@ -25,46 +439,35 @@ void setup() {
 }
 
 void loop() {
-  // put your main code here, to run repeatedly  
-  valor = analogRead(A0);
-
-  if (valor > (valor_0 + 10)){
-    valor_0 = analogRead(A0);
-    Serial.println("Bajar");       
-  
-  }   else if (valor < (valor_0 - 10)) {
-    valor_0 = analogRead(A0);
-    Serial.println("Subir");
-
+  // put your main code here, to run repeatedly
+  while (Serial.available()){
+    // Read incoming led frames
+    parseLedFrameByte(Serial.read());
   }
 
-  if (Serial.available()){
-    // Read incoming data
-    // char incomingData = Serial.read();
+  // The host stopped talking at the negotiated rate, go back to the base one
+  if (currentBaud != BASE_BAUD && millis() - lastValidFrameMillis > LINK_TIMEOUT_MS) {
+    switchBaud(BASE_BAUD);
   }
-  btnState_1 = digitalRead(btnPin_1);
-  btnState_2 = digitalRead(btnPin_2);
 
+  // Inputs are polled without blocking so the serial buffer is always drained
+  if (millis() - lastKnobPollMillis >= KNOB_POLL_MS) {
+    lastKnobPollMillis = millis();
 
-  // Do something with data
-  if (btnState_1 == HIGH) {
-    Serial.print("Comando1\n");
-    digitalWrite(ledPin_1, HIGH);     
+    unsigned long timestamp = micros();
+    valor = analogRead(A0);
 
-  } else if (btnState_1 == LOW) {
-    digitalWrite(ledPin_1, LOW);
+    if (valor > (valor_0 + 10)){
+      valor_0 = valor;
+      sendEvent(CMD_BAJAR, timestamp);
 
-  }
-  
-  if (btnState_2 == HIGH) {
-    Serial.print("Comando2\n");
-    digitalWrite(ledPin_2, HIGH);
-    
-  } else if (btnState_2 == LOW) {
-    digitalWrite(ledPin_2, LOW);
+    }   else if (valor < (valor_0 - 10)) {
+      valor_0 = valor;
+      sendEvent(CMD_SUBIR, timestamp);
 
+    }
   }
 
-  delay(150);
-
+  updateButton(btnPin_1, ledPin_1, btnState_1, btnRepeat_1, CMD_COMANDO1);
+  updateButton(btnPin_2, ledPin_2, btnState_2, btnRepeat_2, CMD_COMANDO2);
 }
@@ -0,0 +1,20 @@
+-- handlers of the lua_callback actions, called as handler(command, repeat_count) on the script worker
+-- key_macro(key, ...) presses the keys (windows virtual keys) and releases them, launch(path) opens a process,
+-- sleep(milliseconds) only waits on the script worker
+
+VK_CONTROL = 0x11
+VK_SHIFT = 0x10
+VK_ESCAPE = 0x1B
+
+function open_task_manager(command, repeat_count)
+    key_macro(VK_CONTROL, VK_SHIFT, VK_ESCAPE)
+end
+
+function type_greeting(command, repeat_count)
+    for i = 1, repeat_count do
+        for _, key in ipairs({ 0x48, 0x4F, 0x4C, 0x41 }) do -- h o l a
+            key_macro(key)
+            sleep(20)
+        end
+    end
+end
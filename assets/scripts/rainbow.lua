@@ -1,9 +1,11 @@
--- num leds x & y
+-- num leds x & y, from the led geometry of the config (read again every frame, the geometry can change)
 
-num_leds_width = 21
-num_leds_height = 21
-offset_center_leds_x = math.floor(num_leds_width / 2)
-offset_center_leds_y = math.floor(num_leds_height / 2)
+function update_geometry()
+    num_leds_width = leds.width
+    num_leds_height = leds.height
+    offset_center_leds_x = math.floor(num_leds_width / 2)
+    offset_center_leds_y = math.floor(num_leds_height / 2)
+end
 
 function colorWheelPattern(x, y, t)
     local angle = math.atan2(y - offset_center_leds_y, x - offset_center_leds_x)
@@ -39,13 +41,14 @@ function hsvToRgb(h, s, v)
 end
 
 function update_leds(time)
+    update_geometry()
     for j = 0, num_leds_height - 1 do
         for i = 0, num_leds_width - 1 do
             local led_index = i + j * num_leds_width
 
             local r, g, b = colorWheelPattern(i, j, time)
 
-            set_led(led_index, r, g, b)
+            leds[led_index] = (r << 16) | (g << 8) | b
         end
     end
 end
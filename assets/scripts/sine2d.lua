@@ -1,16 +1,19 @@
 
--- num leds x & y
+-- num leds x & y, from the led geometry of the config (read again every frame, the geometry can change)
 
-num_leds_width = 21
-num_leds_height = 21
-offset_center_leds_x = math.floor(num_leds_width / 2)
-offset_center_leds_y = math.floor(num_leds_height / 2)
+function update_geometry()
+	num_leds_width = leds.width
+	num_leds_height = leds.height
+	offset_center_leds_x = math.floor(num_leds_width / 2)
+	offset_center_leds_y = math.floor(num_leds_height / 2)
+end
 
 function sineCircularFunction(x, y, r, t)
 	return math.sin(r * math.sqrt(x * x + y * y) + t);
 end
 
 function update_leds(time)
+	update_geometry()
 
 	for j = 0, num_leds_height - 1 do
 		for i = 0, num_leds_width - 1 do
@@ -20,7 +23,7 @@ function update_leds(time)
 			local g = math.abs(math.floor(234 * sineCircularFunction((i - offset_center_leds_x), (j - offset_center_leds_y), 1, 2 * time)))
 			local b = math.abs(math.floor(144 * sineCircularFunction((i - offset_center_leds_x), (j - offset_center_leds_y), 1, 2 * time)))
 
-			set_led(led_index, r, g, b)
+			leds[led_index] = (r << 16) | (g << 8) | b
 		end
 	end
 end
\ No newline at end of file
@@ -0,0 +1,48 @@
+#version 430 core
+
+// drifting fractal value noise, one invocation per led (GpuLedEffect)
+
+layout(local_size_x = 64) in;
+
+layout(std430, binding = 0) writeonly buffer Leds {
+    uint leds[];
+};
+
+uniform float u_time;
+uniform vec2 u_size;
+
+float Hash(vec2 p) {
+    return fract(sin(dot(p, vec2(127.1, 311.7))) * 43758.5453);
+}
+
+float Noise(vec2 p) {
+    vec2 cell = floor(p);
+    vec2 f = fract(p);
+    vec2 u = f * f * (3.0 - 2.0 * f);
+
+    return mix(mix(Hash(cell), Hash(cell + vec2(1.0, 0.0)), u.x),
+               mix(Hash(cell + vec2(0.0, 1.0)), Hash(cell + vec2(1.0, 1.0)), u.x), u.y);
+}
+
+void main() {
+    uint index = gl_GlobalInvocationID.x;
+    uint width = uint(u_size.x);
+
+    if (index >= width * uint(u_size.y))
+        return;
+
+    vec2 position = vec2(index % width, index / width) / 6.0 + vec2(u_time * 0.4, u_time * 0.15);
+
+    float value = 0.0;
+    float amplitude = 0.5;
+
+    for (int octave = 0; octave < 4; octave++) {
+        value += amplitude * Noise(position);
+        position *= 2.0;
+        amplitude *= 0.5;
+    }
+
+    vec3 color = mix(vec3(0.05, 0.0, 0.3), vec3(1.0, 0.35, 0.9), smoothstep(0.25, 0.75, value));
+
+    leds[index] = packUnorm4x8(vec4(color, 1.0));
+}
@@ -0,0 +1,31 @@
+#version 430 core
+
+// plasma of sines, one invocation per led (GpuLedEffect)
+
+layout(local_size_x = 64) in;
+
+layout(std430, binding = 0) writeonly buffer Leds {
+    uint leds[];
+};
+
+uniform float u_time;
+uniform vec2 u_size;
+
+void main() {
+    uint index = gl_GlobalInvocationID.x;
+    uint width = uint(u_size.x);
+
+    if (index >= width * uint(u_size.y))
+        return;
+
+    vec2 position = vec2(index % width, index / width) / max(u_size.x, u_size.y) * 8.0;
+
+    float value = sin(position.x + u_time);
+    value += sin(position.y * 0.8 - u_time * 1.3);
+    value += sin(length(position - vec2(4.0 + 3.0 * sin(u_time * 0.5), 4.0)) * 1.5);
+    value *= 0.5;
+
+    vec3 color = 0.5 + 0.5 * cos(3.14159 * value + vec3(0.0, 2.094, 4.188));
+
+    leds[index] = packUnorm4x8(vec4(color, 1.0));
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <functional>
+#include <cstdint>
+
+enum ActionType
+{
+	NONE,
+	KEY_MACRO,
+	OPEN_PROCESS,
+	TIMED_MACRO,
+	SWITCH_PROFILE,
+	LUA_CALLBACK
+};
+
+// hash that allows looking up std::string keys with std::string_view (no temporary strings)
+
+struct StringHash
+{
+	using is_transparent = void;
+
+	size_t operator()(std::string_view str) const { return std::hash<std::string_view>{}(str); }
+};
+
+// step of a TIMED_MACRO, the times are in milliseconds
+
+enum class MacroStepType
+{
+	PRESS, // key down
+	RELEASE, // key up
+	TAP, // key down & up
+	HOLD, // key down, wait milliseconds, key up
+	DELAY, // wait milliseconds
+	TEXT, // type the text, milliseconds between the characters
+	REPEAT // the nested steps count times
+};
+
+struct MacroStep
+{
+	MacroStepType type;
+	unsigned char key = 0;
+	uint32_t milliseconds = 0;
+	uint32_t count = 0;
+	std::string text;
+	std::vector<MacroStep> steps;
+
+	bool operator==(const MacroStep&) const = default;
+};
+
+struct Action
+{
+	ActionType type;
+	std::vector<unsigned char> keys;
+	std::string processPath;
+	std::vector<MacroStep> steps;
+	std::string profileName;
+	std::string luaFunction; // handler of a LUA_CALLBACK
+};
+
+// command name -> action, can be looked up with a std::string_view
+
+using CommandsMap = std::unordered_map<std::string, Action, StringHash, std::equal_to<>>;
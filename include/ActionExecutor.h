@@ -0,0 +1,83 @@
+#pragma once
+
+#include <memory>
+#include <cstdint>
+#include "CommandTable.h"
+#include "InputInjector.h"
+#include "ProcessLauncher.h"
+#include "MacroScheduler.h"
+#include "ScriptWorker.h"
+#include "Core/ThreadPool.h"
+#include "Core/LatencyHistogram.h"
+
+/* ACTION EXECUTOR */
+
+// performs the actions away from the serial listeners, which only queue them and never wait
+// key macros go through one lane so they are injected in the order they arrived, process launches
+// (CreateProcess can block for a long time) run in parallel on the other workers
+// the key macros are injected by the input injector and the processes launched by the process launcher, both from
+// what they compiled & prepared in the command table
+// the timed macros are run by the macro scheduler, which hands their batches to the key macro lane when due
+// the lua callbacks run on the script worker, their scripts can queue key macros & process launches to the lanes
+
+class ActionExecutor
+{
+public:
+	// queue: submitted -> started, execution: started -> finished (microseconds)
+
+	struct LaneStats
+	{
+		LatencyHistogram queue;
+		LatencyHistogram execution;
+	};
+
+	ActionExecutor(std::unique_ptr<InputInjector> inputInjector, std::unique_ptr<ProcessLauncher> processLauncher, int processWorkersCount = 2);
+
+	// the command tables must be compiled with this injector & launcher
+
+	InputInjector& GetInputInjector() { return *m_inputInjector; }
+	const InputInjector& GetInputInjector() const { return *m_inputInjector; }
+	ProcessLauncher& GetProcessLauncher() { return *m_processLauncher; }
+	const ProcessLauncher& GetProcessLauncher() const { return *m_processLauncher; }
+
+	const LaneStats& GetKeyMacroStats() const { return m_keyMacroStats; }
+	const LaneStats& GetProcessStats() const { return m_processStats; }
+	const MacroScheduler& GetMacroScheduler() const { return m_macroScheduler; }
+	ScriptWorker& GetScriptWorker() { return m_scriptWorker; }
+	const ScriptWorker& GetScriptWorker() const { return m_scriptWorker; }
+	void ResetStats();
+
+	// queue the action of the command, the table is kept alive until the action has been performed
+
+	void Submit(std::shared_ptr<const CommandTable> commandTable, uint16_t commandId, unsigned int repeatCount = 1);
+
+private:
+	// a batch of a timed macro or a key macro of a script, in the key macro lane so it keeps the order with the key
+	// macros (the owner keeps the sequence alive)
+
+	void SubmitSequence(std::shared_ptr<const void> owner, const InputSequence& sequence);
+	void SubmitProcess(std::shared_ptr<const PreparedProcess> preparedProcess);
+
+	// functions of the callback scripts: key_macro(key, ...), launch(path), sleep(milliseconds)
+
+	void SetupScript(lua_State* l);
+	static int KeyMacroLuaWrap(lua_State* l);
+	static int LaunchLuaWrap(lua_State* l);
+	static int SleepLuaWrap(lua_State* l);
+
+private:
+	std::unique_ptr<InputInjector> m_inputInjector;
+	std::unique_ptr<ProcessLauncher> m_processLauncher;
+	LaneStats m_keyMacroStats;
+	LaneStats m_processStats;
+
+	// the workers are destroyed first so no job outlives the stats
+
+	ThreadPool m_keyMacroLane; // one worker, keeps the order
+	ThreadPool m_processWorkers;
+
+	// destroyed before the lanes they submit to
+
+	MacroScheduler m_macroScheduler;
+	ScriptWorker m_scriptWorker;
+};
@@ -1,12 +1,19 @@
 #pragma once
 
-#include <thread>
 #include <string>
-#include <asio.hpp>
+#include <string_view>
 #include <vector>
-#include <unordered_map>
-#include <functional>
+#include <map>
 #include <cstdint>
+#include <memory>
+#include "Action.h"
+#include "CommandTable.h"
+#include "Config.h"
+#include "MacroPadDeviceManager.h"
+#include "LedBuffer.h"
+#include "LedGeometry.h"
+#include "LedEffectEngine.h"
+#include "GpuLedEffect.h"
 
 extern "C"
 {
@@ -15,29 +22,12 @@ extern "C"
 #include <lauxlib.h>
 }
 
-enum ActionType
-{
-	NONE,
-	KEY_MACRO,
-	OPEN_PROCESS
-};
-
-struct Action
-{
-	ActionType type;
-	std::vector<unsigned char> keys;
-	std::string processPath;
-};
-
 class ArduinoMacroPadController
 {
 private:
 	// led struct
 
-	struct led_t
-	{
-		uint8_t r, g, b;
-	};
+	using led_t = LedColor;
 
 public:
 	ArduinoMacroPadController();
@@ -52,35 +42,67 @@ public:
 private:
 	void SerializeConfig(const std::string& path) const;
 	void DeserializeConfig(const std::string& path);
+	void CompileCommands();
+	void DumpLatencyStats(const std::string& path) const;
+	void RegisterLuaFunctions(lua_State* l);
 
-	void ProcessCommand(const std::string& command) const;
-	void CommandListenerProcess();
+	void ProcessCommand(std::string_view command);
+
+	// resize every stage of the leds (buffers, effects, scripts & wiring) to the geometry, the leds start black
+
+	void SetLedGeometry(const LedGeometry& geometry);
 
 	// functions that have a lua wrap
 
-	inline void SetLedColor(int index, led_t color) { m_ledsData[index] = color; }
+	inline void SetLedColor(int index, led_t color) { if ((size_t)index < m_leds.GetNumLeds()) m_leds[index] = color; }
 	static int SetLedColorLuaWrap(lua_State* l);
 
-	inline led_t GetLedColor(int index) const { return m_ledsData[index]; }
+	inline led_t GetLedColor(int index) const { return (size_t)index < m_leds.GetNumLeds() ? m_leds[index] : led_t{ 0, 0, 0 }; }
 	static int GetLedColorLuaWrap(lua_State* l);
 
+	inline bool SetProfile(const std::string& name) { return m_deviceManager.GetProfileManager().SwitchProfile(name); }
+	static int SetProfileLuaWrap(lua_State* l);
+
+	inline std::string GetProfile() const { return m_deviceManager.GetProfileManager().GetActiveProfile(); }
+	static int GetProfileLuaWrap(lua_State* l);
+
+	inline void SetLedEffect(const LedEffect& effect) { m_ledEffectEngine.SetEffect(effect); }
+	static int SetLedEffectLuaWrap(lua_State* l);
+
+	inline const LedEffect& GetLedEffect() const { return m_ledEffectEngine.GetEffect(); }
+	static int GetLedEffectLuaWrap(lua_State* l);
+
+	// activate the profile of the application that got the focus (if it has one)
+
+	void UpdateForegroundProfile();
+
 private:
-	unsigned int m_baudios;
-	std::string m_portName;
-	std::thread m_listenerThread;
+	// connected macro pads (they dispatch with the table of the active profile)
+
+	MacroPadDeviceManager m_deviceManager;
+
+	// profiles of commands & actions (edited in the maps and compiled into the tables of the profile manager)
+	// a profile is activated when one of its applications (executable names) gets the focus
+
+	static constexpr float s_foregroundPollInterval = 0.25f; // seconds
+
+	std::map<std::string, Config::Profile> m_profiles;
+	std::string m_foregroundApplication;
+	float m_foregroundPollTime;
 
-	// asio serial port
+	// leds of the matrix (indexed x + y * width) & the same leds in wiring order (only if the geometry reorders them)
 
-	asio::io_service m_io;
-	asio::serial_port m_port;
+	LedGeometry m_ledGeometry;
+	LedBuffer m_leds;
+	LedBuffer m_wiredLeds;
 
-	// commands & actions
+	// built-in effect written into the leds each update (the SCRIPT effect leaves them to update_leds of the script)
 
-	std::unordered_map<std::string, Action> m_commandsMap;
+	LedEffectEngine m_ledEffectEngine;
 
-	// leds of the macro keys
+	// SHADER effect, loaded on the first update that uses it (the opengl context doesn't exist yet in the constructor)
 
-	led_t m_ledsData[441]; // 9 keys
+	GpuLedEffect m_gpuLedEffect;
 
 	// lua scripting
 
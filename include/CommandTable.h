@@ -0,0 +1,73 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+#include <memory>
+#include "Action.h"
+#include "InputInjector.h"
+#include "ProcessLauncher.h"
+#include "TimedMacro.h"
+
+/* COMMAND TABLE */
+
+// the commands map compiled into a read only dispatch table, every command gets a dense id (its index in name order)
+// and the names are found with an open addressing hash table, so a lookup never allocates and stays constant time
+//
+// commands with the same action share it, so the 441 KEYn entries that open the same process keep one copy of the path
+// the key macros are compiled into input sequences by the injector that will inject them and the processes are
+// prepared by the launcher that will launch them, the timed macros are compiled into timed batches by the injector
+
+class CommandTable
+{
+public:
+	static constexpr uint16_t s_invalidId = 0xFFFF;
+	static constexpr size_t s_maxCommands = s_invalidId;
+
+	CommandTable();
+	explicit CommandTable(const CommandsMap& commandsMap, const InputInjector* inputInjector = nullptr, const ProcessLauncher* processLauncher = nullptr);
+
+	size_t GetNumCommands() const { return m_actionIndices.size(); }
+	size_t GetNumActions() const { return m_actions.size(); }
+
+	// id of the command, s_invalidId if it isn't in the table
+
+	uint16_t Find(std::string_view name) const;
+
+	std::string_view GetName(uint16_t id) const { return std::string_view(m_names).substr(m_nameOffsets[id], m_nameOffsets[id + 1] - m_nameOffsets[id]); }
+	const Action& GetAction(uint16_t id) const { return m_actions[m_actionIndices[id]]; }
+
+	// compiled events of a key macro, nullptr for the other actions or without an injector
+
+	const InputSequence* GetInputSequence(uint16_t id) const { return m_inputSequences[m_actionIndices[id]].get(); }
+
+	// prepared process of an OPEN_PROCESS action, nullptr for the other actions, without a launcher or if it can't be launched
+
+	const PreparedProcess* GetPreparedProcess(uint16_t id) const { return m_preparedProcesses[m_actionIndices[id]].get(); }
+
+	// compiled steps of a TIMED_MACRO action, nullptr for the other actions or without an injector
+
+	const TimedMacro* GetTimedMacro(uint16_t id) const { return m_timedMacros[m_actionIndices[id]].get(); }
+
+private:
+	// the hash is stored so most mismatches are rejected without comparing the names
+
+	struct Slot
+	{
+		uint32_t hash;
+		uint16_t id; // s_invalidId if empty
+	};
+
+	static uint32_t Hash(std::string_view name);
+
+private:
+	std::vector<Slot> m_slots; // power of two, at most half full
+	std::string m_names; // every name back to back
+	std::vector<uint32_t> m_nameOffsets; // num commands + 1
+	std::vector<uint16_t> m_actionIndices; // command id -> action
+	std::vector<Action> m_actions;
+	std::vector<std::shared_ptr<const InputSequence>> m_inputSequences; // one per action
+	std::vector<std::shared_ptr<const PreparedProcess>> m_preparedProcesses; // one per action
+	std::vector<std::unique_ptr<const TimedMacro>> m_timedMacros; // one per action
+};
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <map>
+#include <optional>
+#include "Action.h"
+#include "LedEffectEngine.h"
+#include "LedGeometry.h"
+
+/* CONFIG */
+
+// the config file as plain data, (de)serialized to json without a running controller (which applies it)
+// the configs without profiles are the commands of the default profile, the missing led sections are left unset
+
+struct Config
+{
+	// commands & actions of a profile, activated when one of its applications (executable names) gets the focus
+
+	struct Profile
+	{
+		CommandsMap commandsMap;
+		std::vector<std::string> applications;
+	};
+
+	static constexpr const char* s_defaultProfile = "default";
+
+	std::map<std::string, Profile> profiles;
+	std::string activeProfile; // empty if the file doesn't set it
+	std::optional<LedEffect> ledEffect;
+	std::optional<LedGeometry> ledGeometry;
+
+	// json text, a malformed text throws the nlohmann::json parse error
+
+	std::string Serialize() const;
+	static Config Deserialize(std::string_view text);
+
+	void Save(const std::string& path) const;
+	static Config Load(const std::string& path);
+
+	// names of the led effect types in the config & the lua scripts, false if there is no type with that name
+
+	static const std::string& GetLedEffectTypeName(LedEffectType type);
+	static bool FindLedEffectType(std::string_view name, LedEffectType& type);
+};
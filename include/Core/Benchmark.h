@@ -0,0 +1,43 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <functional>
+#include <cstdint>
+
+// microbenchmark runner, a case is a body that performs its operation a given number of times
+// the iterations are calibrated so a sample lasts about s_sampleTimeNs, then s_numSamples samples are timed and the
+// time per operation of the median, fastest & slowest sample is kept
+
+class Benchmark
+{
+public:
+	static constexpr uint64_t s_sampleTimeNs = 20000000; // 20 ms
+	static constexpr int s_numSamples = 7;
+
+	using Body = std::function<void(uint64_t iterations)>;
+
+	struct Result
+	{
+		std::string name;
+		uint64_t iterations; // per sample
+		double medianNs; // per operation
+		double minNs;
+		double maxNs;
+	};
+
+	void Run(const std::string& name, const Body& body);
+
+	const std::vector<Result>& GetResults() const { return m_results; }
+	void Clear() { m_results.clear(); }
+
+	// keeps the compiler from optimizing a result away
+
+	static void Consume(uint64_t value);
+
+private:
+	static uint64_t Time(const Body& body, uint64_t iterations);
+
+private:
+	std::vector<Result> m_results;
+};
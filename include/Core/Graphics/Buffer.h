@@ -129,4 +129,41 @@ public:
 private:
 	uint32_t m_id;
 	size_t m_size;
-};
\ No newline at end of file
+};
+
+// shader storage buffer written by the gpu & read by the cpu without stalling (instead of GetData), the storage is
+// immutable & mapped once (persistent & coherent) and split in regions, the gpu writes one while the cpu reads another
+// and a fence per region tells when the commands that wrote it have finished (needs opengl 4.4 or ARB_buffer_storage)
+
+class MappedShaderStorageBuffer
+{
+public:
+	MappedShaderStorageBuffer(size_t regionSize, uint32_t numRegions);
+	~MappedShaderStorageBuffer();
+
+	uint32_t GetID() const { return m_id; }
+	size_t GetRegionSize() const { return m_regionSize; }
+	uint32_t GetNumRegions() const { return (uint32_t)m_fences.size(); }
+	bool IsMapped() const { return m_data != nullptr; }
+
+	// bind one region to the binding point
+
+	void BindRegion(uint32_t region, uint32_t binding) const;
+
+	// fence the region after the commands that write it (replaces the previous fence)
+
+	void Fence(uint32_t region);
+
+	// the commands before the fence of the region have finished (never waits)
+
+	bool IsReady(uint32_t region) const;
+
+	const void* GetRegionData(uint32_t region) const { return m_data + region * m_regionStride; }
+
+private:
+	uint32_t m_id;
+	size_t m_regionSize;
+	size_t m_regionStride; // region size aligned to the storage buffer offset alignment
+	const uint8_t* m_data;
+	std::vector<void*> m_fences; // GLsync
+};
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+// lock-free latency histogram in microseconds, values under 16 us get their own bucket and
+// every power of two above is split in 8 buckets (~12% precision), it can be recorded from
+// any thread while being read
+
+class LatencyHistogram
+{
+public:
+	static constexpr size_t s_numBuckets = 16 + 60 * 8;
+
+	LatencyHistogram();
+
+	uint64_t GetCount() const { return m_count.load(std::memory_order_relaxed); }
+	uint64_t GetMax() const { return m_max.load(std::memory_order_relaxed); }
+	double GetMean() const;
+
+	// upper bound of the bucket that holds the percentile (0 - 100)
+
+	uint64_t GetPercentile(double percentile) const;
+
+	uint64_t GetBucketCount(size_t bucket) const { return m_buckets[bucket].load(std::memory_order_relaxed); }
+	static uint64_t GetBucketLowerBound(size_t bucket);
+	static uint64_t GetBucketUpperBound(size_t bucket);
+
+	void Record(uint64_t microseconds);
+	void Reset();
+
+private:
+	static size_t GetBucket(uint64_t microseconds);
+
+private:
+	std::atomic<uint64_t> m_buckets[s_numBuckets];
+	std::atomic<uint64_t> m_count;
+	std::atomic<uint64_t> m_sum;
+	std::atomic<uint64_t> m_max;
+};
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <atomic>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// bounded lock-free multi producer / multi consumer queue (every slot has a sequence number that tells whose turn it is)
+// push never blocks, it fails when the queue is full, the capacity is rounded up to a power of two
+
+template <typename T>
+class MpmcQueue
+{
+public:
+	explicit MpmcQueue(size_t capacity)
+	{
+		size_t size = 2;
+
+		while (size < capacity)
+			size *= 2;
+
+		m_slots = std::vector<Slot>(size);
+		m_mask = size - 1;
+
+		for (size_t i = 0; i < size; i++)
+			m_slots[i].sequence.store(i, std::memory_order_relaxed);
+
+		m_pushPosition = 0;
+		m_popPosition = 0;
+	}
+
+	MpmcQueue(const MpmcQueue&) = delete;
+	MpmcQueue& operator=(const MpmcQueue&) = delete;
+
+	size_t GetCapacity() const { return m_mask + 1; }
+
+	bool TryPush(T value)
+	{
+		size_t position = m_pushPosition.load(std::memory_order_relaxed);
+		Slot* slot;
+
+		while (true)
+		{
+			slot = &m_slots[position & m_mask];
+			size_t sequence = slot->sequence.load(std::memory_order_acquire);
+			intptr_t difference = (intptr_t)sequence - (intptr_t)position;
+
+			if (difference == 0)
+			{
+				if (m_pushPosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+					break;
+			}
+			else if (difference < 0)
+			{
+				return false; // full
+			}
+			else
+			{
+				position = m_pushPosition.load(std::memory_order_relaxed);
+			}
+		}
+
+		slot->value = std::move(value);
+		slot->sequence.store(position + 1, std::memory_order_release);
+
+		return true;
+	}
+
+	bool TryPop(T& value)
+	{
+		size_t position = m_popPosition.load(std::memory_order_relaxed);
+		Slot* slot;
+
+		while (true)
+		{
+			slot = &m_slots[position & m_mask];
+			size_t sequence = slot->sequence.load(std::memory_order_acquire);
+			intptr_t difference = (intptr_t)sequence - (intptr_t)(position + 1);
+
+			if (difference == 0)
+			{
+				if (m_popPosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+					break;
+			}
+			else if (difference < 0)
+			{
+				return false; // empty
+			}
+			else
+			{
+				position = m_popPosition.load(std::memory_order_relaxed);
+			}
+		}
+
+		value = std::move(slot->value);
+		slot->value = T();
+		slot->sequence.store(position + m_mask + 1, std::memory_order_release);
+
+		return true;
+	}
+
+private:
+	struct Slot
+	{
+		std::atomic<size_t> sequence;
+		T value;
+
+		Slot() : sequence(0) {}
+	};
+
+	static constexpr size_t s_cacheLineSize = 64;
+
+	std::vector<Slot> m_slots;
+	size_t m_mask;
+	alignas(s_cacheLineSize) std::atomic<size_t> m_pushPosition;
+	alignas(s_cacheLineSize) std::atomic<size_t> m_popPosition;
+};
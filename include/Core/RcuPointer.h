@@ -0,0 +1,82 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <cstdint>
+
+// read-copy-update pointer to an immutable value, the readers never take a lock and never see a half built value
+// a new value is published with one pointer swap, the old one is released once the readers that were copying it
+// are done (grace period: the readers are split in two epochs and the publisher waits for the old one to drain)
+// the readers keep the shared_ptr they loaded, GetGeneration tells them cheaply when to load again
+
+template <typename T>
+class RcuPointer
+{
+public:
+	explicit RcuPointer(std::shared_ptr<const T> value = nullptr)
+	{
+		m_current = new std::shared_ptr<const T>(std::move(value));
+		m_generation = 0;
+		m_epoch = 0;
+		m_readers[0] = 0;
+		m_readers[1] = 0;
+	}
+
+	~RcuPointer() { delete m_current.load(); }
+
+	RcuPointer(const RcuPointer&) = delete;
+	RcuPointer& operator=(const RcuPointer&) = delete;
+
+	// reader side, a reader only retries when a publish flips the epoch under it
+
+	uint64_t GetGeneration() const { return m_generation.load(std::memory_order_acquire); }
+
+	std::shared_ptr<const T> Load() const
+	{
+		uint32_t epoch;
+
+		while (true)
+		{
+			epoch = m_epoch.load();
+			m_readers[epoch & 1].fetch_add(1);
+
+			if (m_epoch.load() == epoch)
+				break;
+
+			m_readers[epoch & 1].fetch_sub(1);
+		}
+
+		std::shared_ptr<const T> value = *m_current.load();
+		m_readers[epoch & 1].fetch_sub(1, std::memory_order_release);
+
+		return value;
+	}
+
+	// writer side, waits for the grace period (the readers only copy a shared_ptr, so it's short)
+
+	void Publish(std::shared_ptr<const T> value)
+	{
+		std::scoped_lock lock(m_publishMutex);
+
+		std::shared_ptr<const T>* previous = m_current.exchange(new std::shared_ptr<const T>(std::move(value)));
+		m_generation.fetch_add(1, std::memory_order_release);
+
+		// the new readers register in the other epoch, the ones that may still see the previous value drain
+
+		uint32_t epoch = m_epoch.fetch_add(1);
+
+		while (m_readers[epoch & 1].load(std::memory_order_acquire) != 0)
+			std::this_thread::yield();
+
+		delete previous;
+	}
+
+private:
+	std::atomic<std::shared_ptr<const T>*> m_current;
+	std::atomic<uint64_t> m_generation; // publish count
+	std::atomic<uint32_t> m_epoch;
+	mutable std::atomic<uint32_t> m_readers[2]; // readers of each epoch parity
+	std::mutex m_publishMutex; // publishers only
+};
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// hierarchical timer wheel, 4 levels of 64 slots so a timer is inserted & fired in constant time whatever the number of timers
+// level 0 holds the timers of the current 64 ticks, the upper ones are moved down (cascaded) when the level below wraps
+// the timers carry a 32 bit payload, not thread safe (owned by one scheduler thread)
+
+class TimerWheel
+{
+public:
+	static constexpr uint64_t s_noExpiry = UINT64_MAX;
+
+	explicit TimerWheel(uint64_t startTick = 0);
+
+	uint64_t GetCurrentTick() const { return m_currentTick; }
+	size_t GetSize() const { return m_size; }
+
+	// timers due at or before the current tick fire on the next advance
+
+	void Schedule(uint64_t tick, uint32_t payload);
+
+	// tick of the next timer of level 0 or of the next cascade (when the upper levels may bring one down), s_noExpiry if empty
+
+	uint64_t GetNextExpiry() const;
+
+	// advance to the tick calling expired(payload) for every timer due, the callback can schedule new timers
+
+	template<typename Callback>
+	void Advance(uint64_t tick, Callback&& expired)
+	{
+		while (m_currentTick < tick)
+		{
+			// nothing to fire, jump
+
+			if (m_size == 0)
+			{
+				m_currentTick = tick;
+				break;
+			}
+
+			// skip the empty slots of level 0 up to the next cascade
+
+			if (m_occupied[0] == 0)
+			{
+				uint64_t nextCascade = (m_currentTick | s_slotMask) + 1;
+
+				if (nextCascade > tick)
+				{
+					m_currentTick = tick;
+					break;
+				}
+
+				m_currentTick = nextCascade - 1;
+			}
+
+			m_currentTick++;
+
+			if ((m_currentTick & s_slotMask) == 0)
+				Cascade();
+
+			// fire the slot (swapped out so the callbacks can schedule into it)
+
+			size_t slot = m_currentTick & s_slotMask;
+
+			if (m_slots[0][slot].empty())
+				continue;
+
+			m_firing.swap(m_slots[0][slot]);
+			m_occupied[0] &= ~(1ull << slot);
+			m_size -= m_firing.size();
+
+			for (const Timer& timer : m_firing)
+				expired(timer.payload);
+
+			m_firing.clear();
+		}
+	}
+
+private:
+	struct Timer
+	{
+		uint64_t tick;
+		uint32_t payload;
+	};
+
+	static constexpr int s_levels = 4;
+	static constexpr int s_slotBits = 6;
+	static constexpr size_t s_slots = 1 << s_slotBits;
+	static constexpr uint64_t s_slotMask = s_slots - 1;
+
+	void Insert(const Timer& timer);
+	void Cascade();
+
+private:
+	uint64_t m_currentTick;
+	size_t m_size;
+	std::vector<Timer> m_slots[s_levels][s_slots];
+	uint64_t m_occupied[s_levels]; // bit = slot with timers
+	std::vector<Timer> m_firing;
+};
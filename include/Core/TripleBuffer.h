@@ -0,0 +1,52 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// lock-free single producer / single consumer triple buffer
+// the producer always has a buffer to write to and the consumer always gets the newest published one,
+// older published buffers that were never consumed are dropped
+
+template <typename T>
+class TripleBuffer
+{
+public:
+	TripleBuffer()
+	{
+		m_writeIndex = 0;
+		m_middle = 1;
+		m_readIndex = 2;
+	}
+
+	// producer side
+
+	T& GetWriteBuffer() { return m_buffers[m_writeIndex]; }
+
+	void Publish()
+	{
+		m_writeIndex = m_middle.exchange(m_writeIndex | s_newBit, std::memory_order_acq_rel) & s_indexMask;
+	}
+
+	// consumer side, returns false if nothing new has been published since the last call
+
+	bool Consume()
+	{
+		if ((m_middle.load(std::memory_order_relaxed) & s_newBit) == 0)
+			return false;
+
+		m_readIndex = m_middle.exchange(m_readIndex, std::memory_order_acq_rel) & s_indexMask;
+
+		return true;
+	}
+
+	const T& GetReadBuffer() const { return m_buffers[m_readIndex]; }
+
+private:
+	static constexpr uint8_t s_newBit = 0x4;
+	static constexpr uint8_t s_indexMask = 0x3;
+
+	T m_buffers[3];
+	uint8_t m_writeIndex; // owned by the producer
+	std::atomic<uint8_t> m_middle; // index of the middle buffer + new bit
+	uint8_t m_readIndex; // owned by the consumer
+};
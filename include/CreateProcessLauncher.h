@@ -0,0 +1,18 @@
+#pragma once
+
+#ifdef _WIN32
+
+#include "ProcessLauncher.h"
+
+/* CREATEPROCESS LAUNCHER */
+
+// launches with CreateProcessA, the handles are closed right away so nothing has to be reaped
+
+class CreateProcessLauncher : public ProcessLauncher
+{
+public:
+	std::shared_ptr<const PreparedProcess> Prepare(const std::string& path) const override;
+	bool Launch(const PreparedProcess& process) override;
+};
+
+#endif
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <string>
+#include <memory>
+#include <cstdint>
+#include "Core/Graphics/ComputeShader.h"
+#include "Core/Graphics/Buffer.h"
+
+/* GPU LED EFFECT */
+
+// led effect written as a glsl compute shader, every invocation writes the color of one led (packUnorm4x8) in the
+// buffer at binding 0, the uniforms are u_time (seconds) & u_size (width & height in leds)
+// the frames are read back a frame late through a persistently mapped buffer: Render dispatches a new frame and copies
+// the newest one that has finished, so the cpu never waits for the gpu
+// everything runs on the thread of the opengl context (4.4 or compute & buffer storage, mesa's llvmpipe works)
+
+class GpuLedEffect
+{
+public:
+	static constexpr uint32_t s_framesInFlight = 3;
+	static constexpr uint32_t s_workGroupSize = 64; // local_size_x of the shaders
+
+	GpuLedEffect();
+
+	// compile the shader & create the buffers, the path is kept even if it fails (so it isn't retried every frame)
+
+	bool Load(const std::string& path, int width, int height);
+	void Unload();
+
+	bool IsLoaded() const { return m_computeShader != nullptr; }
+	const std::string& GetPath() const { return m_path; }
+
+	// dispatch the frame at time (seconds) and write the newest finished frame into rgb (3 bytes per led), false if
+	// no frame has finished since the last call (rgb is left as it is)
+
+	bool Render(float time, uint8_t* rgb);
+
+	static bool IsSupported();
+
+private:
+	std::unique_ptr<ComputeShader> m_computeShader;
+	std::unique_ptr<MappedShaderStorageBuffer> m_ledsBuffer;
+	std::string m_path;
+	int m_width;
+	int m_height;
+	uint64_t m_dispatchedFrames;
+	uint64_t m_readFrames;
+};
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+/* INPUT INJECTION */
+
+// platform independent key event, the keys are windows virtual key codes (the ones used by the config)
+
+struct InputEvent
+{
+	uint8_t key;
+	bool release;
+};
+
+// the events of a macro compiled by an injector, immutable once compiled so the executor workers can share it
+// every injector derives its own sequence with the events already in the format of its api
+
+class InputSequence
+{
+public:
+	explicit InputSequence(std::vector<InputEvent> events) : m_events(std::move(events)) {}
+	virtual ~InputSequence() = default;
+
+	const std::vector<InputEvent>& GetEvents() const { return m_events; }
+
+private:
+	std::vector<InputEvent> m_events;
+};
+
+class InputInjector
+{
+public:
+	// repeats injected with one call, more are split in several calls
+
+	static constexpr unsigned int s_maxBatchedRepeats = 64;
+
+	virtual ~InputInjector() = default;
+
+	// presses in order and then the releases in the reverse order
+
+	static std::vector<InputEvent> BuildKeyMacroEvents(const std::vector<unsigned char>& keys);
+
+	// compile the events once (at config load), the sequence can only be injected by the injector that compiled it
+
+	virtual std::shared_ptr<const InputSequence> Compile(std::vector<InputEvent> events) const = 0;
+
+	// inject the sequence repeat count times, only called from one thread at a time
+
+	virtual void Inject(const InputSequence& sequence, unsigned int repeatCount) = 0;
+};
+
+// injector of the platform (SendInput on windows, uinput on linux), records the events if there is none
+
+std::unique_ptr<InputInjector> CreatePlatformInputInjector();
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <new>
+
+/* LED BUFFER */
+
+// color of one led as it's stored (rgb888)
+
+struct LedColor
+{
+	uint8_t r, g, b;
+};
+
+// leds of the matrix, sized at runtime by the geometry, the storage starts on a cache line and is padded to a whole
+// number of them (the kernels that run over the whole buffer never share a line with other data)
+
+class LedBuffer
+{
+public:
+	static constexpr size_t s_alignment = 64;
+
+	explicit LedBuffer(size_t numLeds = 0);
+
+	// the leds are black after a resize
+
+	void Resize(size_t numLeds);
+
+	size_t GetNumLeds() const { return m_numLeds; }
+	size_t GetSize() const { return m_numLeds * 3; } // bytes
+
+	uint8_t* GetData() { return m_data.get(); }
+	const uint8_t* GetData() const { return m_data.get(); }
+
+	LedColor& operator[](size_t index) { return ((LedColor*)m_data.get())[index]; }
+	const LedColor& operator[](size_t index) const { return ((const LedColor*)m_data.get())[index]; }
+
+private:
+	struct AlignedDeleter
+	{
+		void operator()(uint8_t* data) const { ::operator delete[](data, std::align_val_t(s_alignment)); }
+	};
+
+	std::unique_ptr<uint8_t[], AlignedDeleter> m_data;
+	size_t m_numLeds;
+};
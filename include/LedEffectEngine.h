@@ -0,0 +1,76 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <array>
+#include <cstdint>
+#include <cstddef>
+
+/* LED EFFECT ENGINE */
+
+// built-in led effects computed natively over the whole led buffer instead of one set_led call per led from lua
+// the geometry (angle & distance of every led to the center) is computed once, the kernels are branchless loops over
+// planar float arrays (the compiler vectorizes them) and the result is packed into the rgb888 buffer at the end
+
+enum class LedEffectType
+{
+	SCRIPT, // update_leds of the lua script
+	SOLID, // color
+	GRADIENT, // color -> color2 across the width, scrolled by the speed
+	BREATHING, // color fading in & out
+	COLOR_WHEEL, // hue of the angle around the center, rotated by the speed
+	RADIAL_SINE, // color scaled by |sin(distance * frequency + time * speed)|
+	SHADER // glsl compute shader at shaderPath (run on the gpu by GpuLedEffect, not by the engine)
+};
+
+struct LedEffect
+{
+	LedEffectType type = LedEffectType::SCRIPT;
+	float speed = 1.0f;
+	float frequency = 1.0f; // rings per led (radial sine), repeats per width (gradient)
+	std::array<uint8_t, 3> color = { 255, 255, 255 };
+	std::array<uint8_t, 3> color2 = { 0, 0, 0 };
+	std::string shaderPath;
+};
+
+class LedEffectEngine
+{
+public:
+	LedEffectEngine(int width, int height);
+
+	void SetGeometry(int width, int height);
+	size_t GetNumLeds() const { return m_angles.size(); }
+
+	const LedEffect& GetEffect() const { return m_effect; }
+	void SetEffect(const LedEffect& effect) { m_effect = effect; }
+
+	// false for SCRIPT & SHADER (the leds are left to the script or the gpu)
+
+	bool IsNative() const { return m_effect.type != LedEffectType::SCRIPT && m_effect.type != LedEffectType::SHADER; }
+
+	// write the effect at time (seconds) into rgb (3 bytes per led, GetNumLeds leds)
+
+	void Render(float time, uint8_t* rgb);
+
+private:
+	void Fill(uint8_t* rgb, uint8_t red, uint8_t green, uint8_t blue) const;
+	void RenderGradient(float time);
+	void RenderColorWheel(float time);
+	void RenderRadialSine(float time);
+	void Pack(uint8_t* rgb) const;
+
+private:
+	LedEffect m_effect;
+
+	// per led geometry
+
+	std::vector<float> m_angles; // atan2 around the center, [-pi, pi]
+	std::vector<float> m_distances; // to the center, in leds
+	std::vector<float> m_columns; // x / width, [0, 1)
+
+	// planar channels of the frame (0 - 255)
+
+	std::vector<float> m_red;
+	std::vector<float> m_green;
+	std::vector<float> m_blue;
+};
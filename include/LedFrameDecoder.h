@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <functional>
+#include "LedProtocol.h"
+
+/* LED FRAME DECODER */
+
+// host side version of the decoder in arduino_code/macropad.ino, used to emulate and validate a macro pad
+
+class LedFrameDecoder
+{
+public:
+	struct Frame
+	{
+		LedFrameType type;
+		uint8_t sequence;
+		const uint8_t* payload;
+		size_t size;
+	};
+
+	using FrameCallback = std::function<void(const Frame& frame)>;
+
+	LedFrameDecoder(size_t numLeds);
+
+	const std::vector<uint8_t>& GetLeds() const { return m_leds; }
+	uint8_t GetLastSequence() const { return m_lastSequence; }
+	uint64_t GetCrcErrors() const { return m_crcErrors; }
+
+	// parse the received bytes, the callback gets every frame with a valid crc
+
+	void Feed(const uint8_t* data, size_t size, const FrameCallback& callback);
+
+	// apply a led frame, returns false if it is malformed or can't be applied on the current leds
+
+	bool Apply(const Frame& frame);
+
+private:
+	enum class State
+	{
+		WaitMagic0,
+		WaitMagic1,
+		ReadHeader,
+		ReadPayload,
+		ReadCrc
+	};
+
+	bool DecodeSpans(const uint8_t* data, size_t size);
+
+private:
+	std::vector<uint8_t> m_leds;
+	uint8_t m_lastSequence;
+	bool m_hasFrame;
+	uint64_t m_crcErrors;
+
+	// parser state
+
+	State m_state;
+	uint8_t m_header[LED_FRAME_HEADER_SIZE];
+	size_t m_headerSize;
+	std::vector<uint8_t> m_payload;
+	size_t m_payloadSize;
+	uint8_t m_crc[LED_FRAME_TRAILER_SIZE];
+	size_t m_crcSize;
+};
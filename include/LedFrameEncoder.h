@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <atomic>
+#include "LedProtocol.h"
+#include "LedQuantizer.h"
+
+/* LED FRAME ENCODER */
+
+enum class LedEncoding
+{
+	Full,     // keyframe every frame
+	Delta,    // delta against the acknowledged frame
+	Quantized // delta with the colors reduced to at least rgb565 so small changes don't cost bytes
+};
+
+// encodes each led frame as a delta against the last frame acknowledged by the arduino
+// a delta also covers every change of the frames still in flight, so it is valid on top of any of them
+// a keyframe is sent every keyframe interval frames (or when there is no usable reference) for recovery
+
+class LedFrameEncoder
+{
+public:
+	LedFrameEncoder(uint32_t keyframeInterval = 60);
+
+	uint32_t GetKeyframeInterval() const { return m_keyframeInterval; }
+	LedFrameType GetLastFrameType() const { return m_lastFrameType.load(std::memory_order_relaxed); }
+	size_t GetLastFrameSize() const { return m_lastFrameSize.load(std::memory_order_relaxed); }
+	float GetLastFramePsnr() const { return m_lastFramePsnr.load(std::memory_order_relaxed); } // quality of the color format
+	LedColorFormat GetColorFormat() const { return m_colorFormat.load(std::memory_order_relaxed); }
+
+	void SetKeyframeInterval(uint32_t keyframeInterval) { m_keyframeInterval = keyframeInterval; }
+	void SetColorFormat(LedColorFormat colorFormat) { m_colorFormat.store(colorFormat, std::memory_order_relaxed); }
+
+	// frame types the arduino can decode (bit = LedFrameType), full frames are always used as the fallback
+
+	void SetSupportedFrameTypes(uint32_t frameTypes) { m_supportedFrameTypes.store(frameTypes, std::memory_order_relaxed); }
+
+	// forget every sent frame, the next frame will be a keyframe
+
+	void Reset();
+
+	// called from the listener thread when the arduino acknowledges a frame
+
+	void Acknowledge(uint8_t sequence);
+
+	// encode the leds (rgb888) into a frame, valid until the next call
+	// the payload may point straight into leds, so they must not change until the frame is written
+
+	const LedFrame& Encode(const uint8_t* leds, size_t size, LedEncoding encoding = LedEncoding::Delta);
+
+private:
+	struct SentFrame
+	{
+		bool valid = false;
+		uint8_t sequence = 0;
+		std::vector<uint8_t> leds;
+	};
+
+	static constexpr size_t s_historySize = 16; // frames in flight that can be covered by a delta
+
+	void EncodeSpans(const uint8_t* leds, size_t numLeds, const uint8_t* changed);
+
+private:
+	LedFrameBuilder m_builder;
+	uint32_t m_keyframeInterval;
+	uint32_t m_framesSinceKeyframe;
+
+	std::atomic<int> m_ackedSequence; // -1 when nothing has been acknowledged
+
+	SentFrame m_history[s_historySize];
+	std::vector<uint8_t> m_changed; // one flag per led
+	std::vector<uint8_t> m_payload;
+	std::vector<uint8_t> m_quantized;
+	std::vector<uint8_t> m_keyframePayload;
+	LedPaletteQuantizer m_paletteQuantizer;
+	std::atomic<LedColorFormat> m_colorFormat;
+	std::atomic<uint32_t> m_supportedFrameTypes;
+
+	// stats, read from other threads
+
+	std::atomic<LedFrameType> m_lastFrameType;
+	std::atomic<size_t> m_lastFrameSize;
+	std::atomic<float> m_lastFramePsnr;
+};
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include <chrono>
+#include "LedFrameEncoder.h"
+
+/* LED FRAME SCHEDULER */
+
+// picks the encoding and paces the led frames so they fit in the serial link budget,
+// the budget is the configured baud rate or the measured drain rate of the port if it is slower
+
+class LedFrameScheduler
+{
+public:
+	using Clock = std::chrono::steady_clock;
+
+	LedFrameScheduler(float targetFps = 60.0f);
+
+	// stats, can be read from any thread
+
+	LedEncoding GetEncoding() const { return m_encoding.load(std::memory_order_relaxed); }
+	float GetBytesPerSecond() const { return m_bytesPerSecond.load(std::memory_order_relaxed); }
+	float GetBytesPerFrame() const { return m_bytesPerFrame.load(std::memory_order_relaxed); }
+
+	// call before the writer starts
+
+	void SetBaudRate(unsigned int baudRate);
+
+	// writer side: encoding for the next frame, then report the frame once written,
+	// returns how long to wait before sending the next one
+
+	LedEncoding NextEncoding();
+	Clock::duration OnFrameSent(size_t bytes, Clock::duration writeTime);
+
+private:
+	static constexpr uint32_t s_probeInterval = 120; // frames before trying a better encoding again
+
+	float m_targetFps;
+	float m_baudBytesPerSecond;
+	float m_drainBytesPerSecond; // 0 while the port keeps up with the baud rate
+
+	float m_encodingSizes[3]; // average frame size of each encoding
+	LedEncoding m_currentEncoding; // encoding of the frame being sent (may be a probe)
+	uint32_t m_framesSinceProbe;
+
+	std::atomic<LedEncoding> m_encoding;
+	std::atomic<float> m_bytesPerSecond;
+	std::atomic<float> m_bytesPerFrame;
+};
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include "LedProtocol.h"
+
+/* LED GEOMETRY */
+
+// the leds are a width x height matrix (what the effects, the scripts and the ui draw, indexed x + y * width) built
+// from panels, each panel is a rectangle of the matrix driven by one chain of leds and the chains of the panels are
+// connected in order, so the frame sent to the devices has the leds in wiring order
+// per key groups name the rectangle of leds under a key (looked up by the command of the key)
+
+enum class LedWiring
+{
+	ROW_MAJOR, // every row from left to right
+	SERPENTINE // the odd rows (of the panel) from right to left
+};
+
+struct LedPanel
+{
+	int x = 0;
+	int y = 0;
+	int width = 0;
+	int height = 0;
+	LedWiring wiring = LedWiring::ROW_MAJOR;
+};
+
+struct LedGroup
+{
+	std::string name;
+	int x = 0;
+	int y = 0;
+	int width = 0;
+	int height = 0;
+};
+
+class LedGeometry
+{
+public:
+	static constexpr int s_defaultWidth = 21; // the macro pad
+	static constexpr int s_defaultHeight = 21;
+	static constexpr size_t s_maxLeds = LED_FRAME_MAX_LEDS; // of the matrix and of the chains, every frame must fit
+
+	LedGeometry();
+
+	// the panels outside the matrix are dropped, without panels the matrix is one row major panel
+	// the groups are clipped to the matrix
+
+	LedGeometry(int width, int height, std::vector<LedPanel> panels = {}, std::vector<LedGroup> groups = {});
+
+	int GetWidth() const { return m_width; }
+	int GetHeight() const { return m_height; }
+	size_t GetNumLeds() const { return (size_t)m_width * m_height; }
+
+	const std::vector<LedPanel>& GetPanels() const { return m_panels; }
+	const std::vector<LedGroup>& GetGroups() const { return m_groups; }
+
+	// nullptr if there's no group with the name
+
+	const LedGroup* FindGroup(std::string_view name) const;
+
+	// leds in the chains (the ones of the matrix without a panel aren't sent)
+
+	size_t GetNumWiredLeds() const { return m_wiringOrder.size(); }
+
+	// the wiring order is the matrix order (the leds can be sent as they are)
+
+	bool IsMatrixOrder() const { return m_matrixOrder; }
+
+	// matrix index of every led of the chains, in wiring order
+
+	const std::vector<uint32_t>& GetWiringOrder() const { return m_wiringOrder; }
+
+	// rgb888 leds of the matrix -> rgb888 leds in wiring order (GetNumWiredLeds leds)
+
+	void ToWiringOrder(const uint8_t* matrix, uint8_t* wired) const;
+
+private:
+	int m_width;
+	int m_height;
+	std::vector<LedPanel> m_panels;
+	std::vector<LedGroup> m_groups;
+	std::vector<uint32_t> m_wiringOrder;
+	bool m_matrixOrder;
+};
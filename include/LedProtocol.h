@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+/* LED FRAME PROTOCOL */
+
+// frame layout (little endian), must match arduino_code/macropad.ino:
+//
+// | magic (2) | version (1) | type (1) | length (2) | seq (1) | payload (length) | crc16 (2) |
+//
+// the crc16 (CCITT, init 0xFFFF) covers everything from version to the end of the payload
+
+constexpr uint8_t LED_FRAME_MAGIC_0 = 0xA5;
+constexpr uint8_t LED_FRAME_MAGIC_1 = 0x5A;
+constexpr uint8_t LED_FRAME_VERSION = 1;
+
+constexpr size_t LED_FRAME_HEADER_SIZE = 7;
+constexpr size_t LED_FRAME_TRAILER_SIZE = 2;
+constexpr size_t LED_FRAME_MAX_PAYLOAD_SIZE = 0xFFFF; // length is 16 bits
+constexpr size_t LED_FRAME_MAX_LEDS = LED_FRAME_MAX_PAYLOAD_SIZE / 3; // a raw rgb888 keyframe fits in one frame
+
+// span encoding used by the rle and delta frames, every span is:
+//
+// | skip (2) | op (1) | data |
+//
+// skip = leds left untouched since the end of the previous span (16 bits)
+// op bit 7 set   -> run, (op & 0x7F) + 1 leds of the rgb in data (3 bytes)
+// op bit 7 clear -> literal, (op & 0x7F) + 1 leds with their rgb in data (3 bytes each)
+
+constexpr uint8_t LED_SPAN_RUN_BIT = 0x80;
+constexpr size_t LED_SPAN_MAX_LEDS = 128;
+
+enum class LedFrameType : uint8_t
+{
+	Full = 0x01,    // keyframe, payload = every led as rgb888
+	RleFull = 0x02, // keyframe, payload = spans covering every led
+	Delta = 0x03,   // payload = base seq (1) + spans of the leds that changed since the base frame
+	Full565 = 0x04, // keyframe, payload = every led as rgb565 (little endian)
+	Palette = 0x05, // keyframe, payload = palette size - 1 (1) + palette rgb888 + one palette index per led
+
+	// control frames (not acknowledged)
+
+	Hello = 0x10,  // asks for the capabilities, answered with "CAPS <num leds> <supported frame types mask> <max baud> <micros> <seq>"
+	SetBaud = 0x11,   // payload = baud rate (4), answered with "BAUD <baud>" right before the arduino switches
+	CommandIds = 0x12 // asks for the command ids, answered with "CMDS <id> <name> ..." and then the commands are sent as "#<id>"
+};
+
+uint16_t LedFrameCrc16(const uint8_t* data, size_t size, uint16_t crc = 0xFFFF);
+
+// a frame split in header, payload & trailer so it can be sent with one gather write, the payload
+// is not copied so it must stay valid until the frame has been written
+
+struct LedFrame
+{
+	uint8_t header[LED_FRAME_HEADER_SIZE];
+	const uint8_t* payload;
+	size_t payloadSize;
+	uint8_t trailer[LED_FRAME_TRAILER_SIZE];
+
+	size_t GetSize() const { return LED_FRAME_HEADER_SIZE + payloadSize + LED_FRAME_TRAILER_SIZE; }
+
+	// contiguous copy of the frame
+
+	void CopyTo(std::vector<uint8_t>& frame) const;
+};
+
+class LedFrameBuilder
+{
+public:
+	LedFrameBuilder();
+
+	uint8_t GetSequence() const { return m_sequence; }
+
+	// fills the header & crc around the payload, valid until the next call
+
+	const LedFrame& Build(LedFrameType type, const void* payload, size_t size);
+
+private:
+	LedFrame m_frame;
+	uint8_t m_sequence;
+};
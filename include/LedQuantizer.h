@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+/* LED QUANTIZER */
+
+// wire color formats of the led keyframes
+
+enum class LedColorFormat : uint8_t
+{
+	Rgb888,
+	Rgb565,
+	Palette // adaptive 256 colors palette built per frame
+};
+
+// rgb888 -> rgb565 (little endian, 2 bytes per led)
+
+void PackRgb565(const uint8_t* leds, size_t numLeds, uint8_t* packed);
+
+// rgb888 -> rgb888 as the arduino shows it after a rgb565 round trip
+
+void QuantizeRgb565(const uint8_t* leds, size_t numLeds, uint8_t* quantized);
+
+// per frame palette, the colors are bucketed by their rgb565 value, if there are more than 256 buckets
+// the most used ones form the palette and the rest map to their nearest entry
+
+class LedPaletteQuantizer
+{
+public:
+	LedPaletteQuantizer();
+
+	const std::vector<uint8_t>& GetPalette() const { return m_palette; } // rgb888 triples
+	const std::vector<uint8_t>& GetIndices() const { return m_indices; } // one per led
+	size_t GetPaletteSize() const { return m_palette.size() / 3; }
+
+	// build the palette and indices, quantized = the leds as the arduino shows them
+
+	void Quantize(const uint8_t* leds, size_t numLeds, uint8_t* quantized);
+
+private:
+	std::vector<uint16_t> m_keys; // rgb565 key of each led
+	std::vector<uint16_t> m_usedKeys;
+	std::vector<uint32_t> m_counts; // 65536 buckets
+	std::vector<uint32_t> m_sums; // rgb sums of every bucket
+	std::vector<uint8_t> m_lookup; // bucket -> palette index
+	std::vector<uint8_t> m_palette;
+	std::vector<uint8_t> m_indices;
+};
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include "LedBuffer.h"
+#include "LedGeometry.h"
+
+struct lua_State;
+
+/* LUA LED BUFFER */
+
+// the leds exposed to a lua script as one userdata that reads & writes the rgb888 buffer directly, instead of one
+// set_led / get_led call per led
+// the colors are integers 0xRRGGBB and the leds are indexed from 0 like set_led (x + y * width)
+//
+//   leds[i]                        color of led i (nil out of range)
+//   leds[i] = color                set led i
+//   #leds, leds.width, leds.height
+//   leds:fill(color)               every led
+//   leds:set_row(y, colors)        the row y, colors is a color or a table of up to width colors
+//   leds:set_rect(x, y, w, h, color)
+//   leds:blit(x, y, w, h, colors)  colors is a table of w * h colors (row by row)
+//   leds:group(name)               x, y, w, h of the leds of a key (nil if the geometry has no such group)
+//
+// the rectangles are clipped to the buffer
+
+class LuaLedBuffer
+{
+public:
+	// set the global name of l to a view of the leds with the geometry (both have to outlive the lua state), the view
+	// follows them when they are resized
+
+	static void Register(lua_State* l, const char* name, LedBuffer& leds, const LedGeometry& geometry);
+
+private:
+	struct View
+	{
+		LedBuffer* leds;
+		const LedGeometry* geometry;
+
+		uint8_t* GetData() const { return leds->GetData(); }
+		int GetWidth() const { return geometry->GetWidth(); }
+		int GetHeight() const { return geometry->GetHeight(); }
+		size_t GetNumLeds() const { return leds->GetNumLeds(); }
+	};
+
+	static constexpr const char* s_metatableName = "LedBuffer";
+
+	static View* CheckView(lua_State* l);
+	static void FillRect(const View& view, int x, int y, int width, int height, uint32_t color);
+
+	static int IndexLuaWrap(lua_State* l);
+	static int NewIndexLuaWrap(lua_State* l);
+	static int LengthLuaWrap(lua_State* l);
+	static int FillLuaWrap(lua_State* l);
+	static int SetRowLuaWrap(lua_State* l);
+	static int SetRectLuaWrap(lua_State* l);
+	static int BlitLuaWrap(lua_State* l);
+	static int GroupLuaWrap(lua_State* l);
+};
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <mutex>
+#include <cstdint>
+
+struct lua_State;
+
+/* LUA SCRIPT CACHE */
+
+// scripts compiled once and kept as bytecode (lua_dump) in the cache directory, the next loads only check the source
+// against the hash in the name of the cached file and lua_load the bytecode instead of parsing the source again
+// every entry starts with a header (lua version, hashes of the source & the bytecode, bytecode size) that is checked
+// before lua_load, a changed source or an entry that doesn't match is compiled again and replaces the old one
+// the header only catches stale & damaged entries, not forged ones: the cache directory must be as trusted as the
+// scripts themselves (lua runs any bytecode it is given)
+
+class LuaScriptCache
+{
+public:
+	static constexpr const char* s_directory = "cache/scripts";
+
+	// like luaL_loadfile, the chunk (or the error message) is left on the stack
+
+	static int LoadFile(lua_State* l, const std::string& path);
+
+	// like luaL_dofile
+
+	static int DoFile(lua_State* l, const std::string& path);
+
+private:
+	static uint64_t Hash(std::string_view data);
+
+	// cache entries are written from the ui & the script worker threads
+
+	static std::mutex s_mutex;
+};
@@ -0,0 +1,249 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <deque>
+#include <array>
+#include <cstdint>
+#include <asio.hpp>
+#include "CommandTable.h"
+#include "ProfileManager.h"
+#include "ActionExecutor.h"
+#include "LedFrameEncoder.h"
+#include "LedFrameScheduler.h"
+#include "Core/TripleBuffer.h"
+#include "Core/LatencyHistogram.h"
+
+/* MACRO PAD DEVICE */
+
+// one macro pad on a serial port, every operation is asynchronous and runs on the strand of the device
+// so many devices can share the io_context threads of the MacroPadDeviceManager
+//
+// the port is opened at the base baud rate, the device is asked for its capabilities and both switch
+// to the highest rate they support, if the link stops answering they fall back to the base rate
+
+class MacroPadDevice : public std::enable_shared_from_this<MacroPadDevice>
+{
+public:
+	// input latency stages, from the event on the arduino to the action being queued
+	// receive:  arduino timestamp -> line read by the host (needs the clock offset)
+	// parse:    line read -> command found
+	// dispatch: command found -> action queued on the executor (which measures the rest)
+
+	struct LatencyStats
+	{
+		LatencyHistogram receive;
+		LatencyHistogram parse;
+		LatencyHistogram dispatch;
+	};
+
+	MacroPadDevice(asio::io_context& io, const std::string& portName, unsigned int baudRate, ProfileManager& profileManager, ActionExecutor& actionExecutor);
+	~MacroPadDevice();
+
+	const std::string& GetPortName() const { return m_portName; }
+	unsigned int GetBaseBaudRate() const { return m_baseBaudRate; }
+	unsigned int GetBaudRate() const { return m_baudRate; }
+	bool IsOpen() const { return m_open; }
+
+	// capabilities reported by the device (0 until it answers)
+
+	uint32_t GetDeviceNumLeds() const { return m_deviceNumLeds; }
+	uint32_t GetDeviceFrameTypes() const { return m_deviceFrameTypes; }
+	uint32_t GetDeviceMaxBaudRate() const { return m_deviceMaxBaudRate; }
+
+	// latency histograms (can be read while recording)
+
+	const LatencyStats& GetLatencyStats() const { return m_latencyStats; }
+	void ResetLatencyStats();
+
+	// host clock - arduino clock in microseconds, estimated from the hello round trips
+
+	bool HasClockOffset() const { return m_hasClockOffset; }
+	int64_t GetClockOffset() const { return m_clockOffset; }
+
+	// write stats, every write call ends up in at least one usb packet (64 bytes on the usb cdc arduinos)
+
+	static constexpr size_t s_usbPacketSize = 64;
+
+	uint64_t GetWriteCalls() const { return m_writeCalls; }
+	uint64_t GetWritesCompleted() const { return m_writesCompleted; }
+	uint64_t GetBytesWritten() const { return m_bytesWritten; }
+	uint64_t GetUsbPackets() const { return m_usbPackets; }
+	void ResetWriteStats();
+
+	// led frames per second counted over the last link check, written to the port & acknowledged by the arduino
+	// (the frames it decoded & shows)
+
+	float GetWrittenFps() const { return m_writtenFps; }
+	float GetAcknowledgedFps() const { return m_acknowledgedFps; }
+
+	// send the led frames with one gather write (header, payload & trailer straight from the led buffers)
+	// or copy them into one contiguous buffer first, the serial handles on windows write one buffer per call
+	// so the copy is the default there
+
+	bool GetGatherWrites() const { return m_gatherWrites; }
+	void SetGatherWrites(bool gatherWrites) { m_gatherWrites = gatherWrites; }
+
+	// repeat coalescing, the first command of a run is performed right away and the repeats of the same key macro
+	// that arrive within the window are performed together as one action (0 disables it)
+
+	unsigned int GetCoalesceWindowMs() const { return m_coalesceWindowMs; }
+	void SetCoalesceWindowMs(unsigned int windowMs) { m_coalesceWindowMs = windowMs; }
+	uint64_t GetCommandsReceived() const { return m_commandsReceived; }
+	uint64_t GetActionsDispatched() const { return m_actionsDispatched; }
+
+	// highest baud rate the host side may negotiate, call before Open
+
+	void SetMaxBaudRate(unsigned int maxBaudRate) { m_maxBaudRate = maxBaudRate; }
+
+	const LedFrameEncoder& GetFrameEncoder() const { return m_frameEncoder; }
+	LedFrameEncoder& GetFrameEncoder() { return m_frameEncoder; }
+	const LedFrameScheduler& GetFrameScheduler() const { return m_frameScheduler; }
+
+	// open the port and start listening, returns false if the port couldn't be opened
+
+	bool Open();
+	void Close();
+
+	// the device sends its commands as ids (if it supports them)
+
+	bool IsUsingCommandIds() const { return m_usingCommandIds; }
+
+	// publish the leds (rgb888) to send, never blocks, only one thread may publish
+
+	void PublishLeds(const uint8_t* leds, size_t size);
+
+private:
+	// serial command listener (async reads, lines are split in bulk)
+
+	void StartCommandRead();
+	void OnCommandRead(const asio::error_code& error, size_t bytesRead);
+	void ProcessLine(std::string_view line, LedFrameScheduler::Clock::time_point readTime);
+	void ProcessCommand(uint16_t commandId, uint32_t deviceTime, bool hasDeviceTime, LedFrameScheduler::Clock::time_point readTime);
+	void OnCommandIds(std::string_view commandIds);
+	void OnCommandTablePublished();
+
+	// repeat coalescing
+
+	void Dispatch(uint16_t commandId, unsigned int repeatCount, LedFrameScheduler::Clock::time_point parsedTime);
+	void StartCoalesceWindow(uint16_t commandId);
+	void OnCoalesceTimer();
+
+	// writer, sends the queued control frames first and then the newest published led frame once the previous one drained
+
+	void TrySend();
+	void SendControlFrame(LedFrameType type, const void* payload, size_t size);
+
+	// completion condition of the writes (counts the write calls) & its completion
+
+	size_t OnWriteProgress(const asio::error_code& error, size_t bytesWritten);
+	void OnWriteDone(size_t bytesWritten);
+
+	// baud rate negotiation & link supervision
+
+	void OnCapabilities(uint32_t numLeds, uint32_t frameTypes, uint32_t maxBaudRate);
+	void OnClockSample(uint32_t deviceTime, LedFrameScheduler::Clock::time_point receiveTime);
+	uint64_t UnwrapDeviceTime(uint32_t deviceTime);
+	void SetPortBaudRate(unsigned int baudRate);
+	void StartLinkTimer();
+	void OnLinkTimer();
+
+private:
+	std::string m_portName;
+	unsigned int m_baseBaudRate;
+	unsigned int m_maxBaudRate;
+	std::atomic<unsigned int> m_baudRate;
+	std::atomic<bool> m_open;
+
+	asio::strand<asio::io_context::executor_type> m_strand;
+	asio::serial_port m_port;
+	asio::steady_timer m_pacingTimer;
+	asio::steady_timer m_linkTimer;
+	asio::steady_timer m_coalesceTimer;
+
+	// negotiation state (strand only)
+
+	std::atomic<uint32_t> m_deviceNumLeds;
+	std::atomic<uint32_t> m_deviceFrameTypes;
+	std::atomic<uint32_t> m_deviceMaxBaudRate;
+	unsigned int m_requestedBaudRate; // 0 if no switch is pending
+	LedFrameScheduler::Clock::time_point m_baudRequestTime;
+	std::vector<unsigned int> m_failedBaudRates;
+	LedFrameScheduler::Clock::time_point m_lastReceiveTime; // last line that proves the link works
+	uint32_t m_unackedFrames;
+
+	// latency & clock offset (micros() on the arduino is 32 bits and wraps every ~71 minutes)
+
+	LatencyStats m_latencyStats;
+	std::atomic<bool> m_hasClockOffset;
+	std::atomic<int64_t> m_clockOffset;
+	int64_t m_clockOffsetRoundTrip; // round trip of the sample used, grows a bit with every sample so the estimate follows drift
+	LedFrameScheduler::Clock::time_point m_helloSendTime;
+	uint8_t m_helloSequence; // frame sequence of the last hello sent, echoed in its CAPS answer
+	uint32_t m_lastDeviceTime;
+	uint64_t m_deviceTimeWraps;
+
+	// control frames waiting to be sent (strand only)
+
+	LedFrameBuilder m_controlFrameBuilder;
+	std::deque<std::vector<uint8_t>> m_controlFrames;
+	std::vector<uint8_t> m_controlFrameInFlight;
+
+	// receive buffer of the command listener, holds at most one partial line between reads
+
+	static constexpr size_t s_receiveBufferSize = 4096;
+
+	char m_receiveBuffer[s_receiveBufferSize];
+	size_t m_receiveSize;
+
+	// commands & actions, the table of the active profile is loaded again when a new one is published
+	// the ids of the device are translated to the ids of the table (resolved again with every table)
+
+	ProfileManager& m_profileManager;
+	std::shared_ptr<const CommandTable> m_commandTable; // strand only
+	uint64_t m_commandTableGeneration; // generation of the profile manager the table was loaded at
+	std::vector<uint16_t> m_deviceCommandIds; // device id -> table id (strand only)
+	std::vector<std::string> m_deviceCommandNames; // device id -> name (strand only)
+	std::atomic<bool> m_usingCommandIds;
+	ActionExecutor& m_actionExecutor;
+
+	// repeat coalescing (strand only), the pending repeats of the action of the open window
+
+	static constexpr unsigned int s_maxCoalescedRepeats = 64;
+
+	std::atomic<unsigned int> m_coalesceWindowMs;
+	uint16_t m_coalesceCommandId; // CommandTable::s_invalidId when no window is open
+	unsigned int m_coalescedRepeats;
+	LedFrameScheduler::Clock::time_point m_coalesceFirstTime; // parse time of the first pending repeat
+	std::atomic<uint64_t> m_commandsReceived;
+	std::atomic<uint64_t> m_actionsDispatched;
+
+	// led frames sent to the arduino (delta encoded against the acknowledged frames)
+
+	LedFrameEncoder m_frameEncoder;
+	LedFrameScheduler m_frameScheduler;
+	TripleBuffer<std::vector<uint8_t>> m_ledsTripleBuffer;
+	std::atomic<bool> m_sendQueued; // a TrySendLeds is already posted
+	bool m_sending; // a frame is being written or drained (strand only)
+	std::atomic<bool> m_gatherWrites;
+	std::vector<uint8_t> m_contiguousLedFrame; // only used without gather writes
+
+	// write stats
+
+	size_t m_writeAccounted; // bytes of the current write already counted (strand only)
+	std::atomic<uint64_t> m_writeCalls;
+	std::atomic<uint64_t> m_writesCompleted;
+	std::atomic<uint64_t> m_bytesWritten;
+	std::atomic<uint64_t> m_usbPackets;
+
+	// led frame rate (strand only, except the results)
+
+	uint32_t m_framesWritten;
+	uint32_t m_framesAcknowledged;
+	LedFrameScheduler::Clock::time_point m_fpsTime;
+	std::atomic<float> m_writtenFps;
+	std::atomic<float> m_acknowledgedFps;
+};
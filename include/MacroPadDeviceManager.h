@@ -0,0 +1,46 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <optional>
+#include <asio.hpp>
+#include "MacroPadDevice.h"
+#include "ActionExecutor.h"
+#include "ProfileManager.h"
+
+/* MACRO PAD DEVICE MANAGER */
+
+// every device shares one io_context run by a small fixed number of threads, one action executor and the profiles
+
+class MacroPadDeviceManager
+{
+public:
+	MacroPadDeviceManager(int threadsCount = 1);
+	~MacroPadDeviceManager();
+
+	const std::vector<std::shared_ptr<MacroPadDevice>>& GetDevices() const { return m_devices; }
+	ActionExecutor& GetActionExecutor() { return m_actionExecutor; }
+	const ActionExecutor& GetActionExecutor() const { return m_actionExecutor; }
+	ProfileManager& GetProfileManager() { return m_profileManager; }
+	const ProfileManager& GetProfileManager() const { return m_profileManager; }
+
+	// returns nullptr if the port couldn't be opened, the device dispatches with the active profile
+
+	std::shared_ptr<MacroPadDevice> AddDevice(const std::string& portName, unsigned int baudRate);
+	void RemoveDevice(const std::string& portName);
+	void RemoveAllDevices();
+
+	// publish the same leds to every device
+
+	void PublishLeds(const uint8_t* leds, size_t size);
+
+private:
+	asio::io_context m_io;
+	ActionExecutor m_actionExecutor; // outlives the io threads, its process launcher reaps on the io
+	ProfileManager m_profileManager;
+	std::optional<asio::executor_work_guard<asio::io_context::executor_type>> m_workGuard;
+	std::vector<std::thread> m_threads;
+	std::vector<std::shared_ptr<MacroPadDevice>> m_devices;
+};
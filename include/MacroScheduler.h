@@ -0,0 +1,83 @@
+#pragma once
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <vector>
+#include <cstdint>
+#include "CommandTable.h"
+#include "Core/TimerWheel.h"
+#include "Core/LatencyHistogram.h"
+
+/* MACRO SCHEDULER */
+
+// runs the timed macros, one thread waits for the next batch of every running macro on a timer wheel (1 ms ticks)
+// so a macro costs a slot in the wheel and no thread, however many are running
+// the batches are handed to the inject callback when due, the lateness of every batch is recorded as the jitter
+
+class MacroScheduler
+{
+public:
+	using Clock = std::chrono::steady_clock;
+
+	// called from the scheduler thread, the table is the one the sequence belongs to (to keep it alive)
+
+	using InjectCallback = std::function<void(const std::shared_ptr<const CommandTable>& commandTable, const InputSequence& sequence)>;
+
+	explicit MacroScheduler(InjectCallback injectCallback);
+	~MacroScheduler();
+
+	// start the timed macro of the command now, repeat count times in a row, never waits
+
+	void Start(std::shared_ptr<const CommandTable> commandTable, uint16_t commandId, unsigned int repeatCount = 1);
+
+	size_t GetRunningMacros() const { return m_runningMacros.load(std::memory_order_relaxed); }
+
+	// due -> handed to the callback (microseconds)
+
+	const LatencyHistogram& GetJitter() const { return m_jitter; }
+	void ResetStats() { m_jitter.Reset(); }
+
+private:
+	struct Macro
+	{
+		std::shared_ptr<const CommandTable> commandTable;
+		const TimedMacro* timedMacro;
+		Clock::time_point startTime; // of the current repeat
+		unsigned int repeatsLeft;
+		uint32_t nextBatch;
+	};
+
+	void Run();
+	void ScheduleNextBatch(uint32_t macroIndex);
+	void OnTimer(uint32_t macroIndex);
+
+	// tick of a time point, rounded up so a batch is never early
+
+	uint64_t GetTick(Clock::time_point time) const;
+
+private:
+	InjectCallback m_injectCallback;
+	Clock::time_point m_epoch; // tick 0
+	LatencyHistogram m_jitter;
+	std::atomic<size_t> m_runningMacros;
+
+	// started macros waiting to be picked by the thread
+
+	std::vector<Macro> m_startedMacros;
+	bool m_stopping;
+	std::mutex m_mutex;
+	std::condition_variable m_condition;
+
+	// owned by the thread
+
+	TimerWheel m_timerWheel;
+	std::vector<Macro> m_macros; // the timer payload is the index
+	std::vector<uint32_t> m_freeMacros;
+
+	std::thread m_thread;
+};
@@ -0,0 +1,38 @@
+#pragma once
+
+#ifndef _WIN32
+
+#include <vector>
+#include <mutex>
+#include <sys/types.h>
+#include "ProcessLauncher.h"
+
+/* POSIX SPAWN LAUNCHER */
+
+// launches with posix_spawn (vfork like, the address space of the controller isn't copied), the executable
+// is resolved in the PATH and the argv is split when the process is prepared, so a launch only spawns
+// the children are reaped on the io_context when SIGCHLD arrives
+
+class PosixSpawnLauncher : public ProcessLauncher
+{
+public:
+	PosixSpawnLauncher(asio::io_context& io);
+
+	std::shared_ptr<const PreparedProcess> Prepare(const std::string& path) const override;
+	bool Launch(const PreparedProcess& process) override;
+	void Stop() override;
+
+	size_t GetRunningChildren() const;
+
+private:
+	void StartReaping();
+	void ReapChildren();
+
+private:
+	asio::strand<asio::io_context::executor_type> m_strand;
+	asio::signal_set m_childSignal;
+	mutable std::mutex m_childrenMutex; // held while spawning so a child is known before its SIGCHLD is handled
+	std::vector<pid_t> m_children;
+};
+
+#endif
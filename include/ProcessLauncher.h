@@ -0,0 +1,44 @@
+#pragma once
+
+#include <string>
+#include <memory>
+#include <asio.hpp>
+
+/* PROCESS LAUNCHING */
+
+// the process of an OPEN_PROCESS action prepared once (at config load) by a launcher, immutable once
+// prepared so the executor workers can share it, every launcher derives its own with what its api needs
+
+class PreparedProcess
+{
+public:
+	explicit PreparedProcess(std::string path) : m_path(std::move(path)) {}
+	virtual ~PreparedProcess() = default;
+
+	const std::string& GetPath() const { return m_path; }
+
+private:
+	std::string m_path;
+};
+
+class ProcessLauncher
+{
+public:
+	virtual ~ProcessLauncher() = default;
+
+	// prepare the path (command line) once, returns nullptr if it can't be launched
+
+	virtual std::shared_ptr<const PreparedProcess> Prepare(const std::string& path) const = 0;
+
+	// launch the process, can be called from several threads at once
+
+	virtual bool Launch(const PreparedProcess& process) = 0;
+
+	// stop the work the launcher keeps on the io_context, called before the io threads are joined
+
+	virtual void Stop() {}
+};
+
+// launcher of the platform (CreateProcess on windows, posix_spawn elsewhere), the io_context is used to reap the children
+
+std::unique_ptr<ProcessLauncher> CreatePlatformProcessLauncher(asio::io_context& io);
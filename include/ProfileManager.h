@@ -0,0 +1,57 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+#include "CommandTable.h"
+#include "Core/RcuPointer.h"
+
+/* PROFILE MANAGER */
+
+// named command tables (profiles / layers), the table of the active profile is published with an rcu pointer swap
+// so the listeners read it without a lock, check the generation on every event and load the table when it changed
+// a switch is seen by the next event of every device, the dispatch never pauses (the previous table is kept alive by
+// whoever still uses it)
+
+class ProfileManager
+{
+public:
+	struct Profile
+	{
+		std::string name;
+		std::shared_ptr<const CommandTable> commandTable;
+	};
+
+	ProfileManager();
+
+	// replace the profiles, the active one is kept if it's still there (by name), otherwise the first one is activated
+
+	void SetProfiles(std::vector<Profile> profiles);
+
+	// returns false if there is no profile with that name
+
+	bool SwitchProfile(std::string_view name);
+
+	std::string GetActiveProfile() const;
+	std::vector<std::string> GetProfileNames() const;
+	uint64_t GetSwitchCount() const { return m_switchCount.load(std::memory_order_relaxed); }
+
+	// reader side (lock-free)
+
+	uint64_t GetGeneration() const { return m_activeTable.GetGeneration(); }
+	std::shared_ptr<const CommandTable> GetActiveTable() const { return m_activeTable.Load(); }
+
+private:
+	void Activate(size_t profile);
+
+private:
+	mutable std::mutex m_mutex; // writers & the profile list, never taken by the listeners
+	std::vector<Profile> m_profiles;
+	size_t m_activeProfile;
+	std::atomic<uint64_t> m_switchCount;
+	RcuPointer<CommandTable> m_activeTable;
+};
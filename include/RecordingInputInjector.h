@@ -0,0 +1,26 @@
+#pragma once
+
+#include <mutex>
+#include "InputInjector.h"
+
+/* RECORDING INPUT INJECTOR */
+
+// keeps every injected event in memory instead of sending it, for tests, benchmarks and platforms without injection
+
+class RecordingInputInjector : public InputInjector
+{
+public:
+	std::shared_ptr<const InputSequence> Compile(std::vector<InputEvent> events) const override;
+	void Inject(const InputSequence& sequence, unsigned int repeatCount) override;
+
+	// injected events & number of inject calls (can be read from any thread)
+
+	std::vector<InputEvent> GetEvents() const;
+	size_t GetInjectCalls() const;
+	void Clear();
+
+private:
+	mutable std::mutex m_mutex;
+	std::vector<InputEvent> m_events;
+	size_t m_injectCalls = 0;
+};
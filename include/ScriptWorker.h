@@ -0,0 +1,91 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <map>
+#include <chrono>
+#include <cstdint>
+#include "CommandTable.h"
+#include "Core/MpmcQueue.h"
+#include "Core/LatencyHistogram.h"
+
+struct lua_State;
+
+/* SCRIPT WORKER */
+
+// runs the LUA_CALLBACK actions on its own thread with its own lua state (not the one of the led animation), the
+// callbacks are queued through a lock-free queue so the listeners never wait, a slow script only delays the callbacks
+// behind it
+// the handler of a callback is a global function of the loaded script, called as handler(command, repeat count)
+
+class ScriptWorker
+{
+public:
+	using Clock = std::chrono::steady_clock;
+
+	// called on the worker thread with every new lua state (to register the functions the scripts can use)
+
+	using SetupCallback = std::function<void(lua_State* l)>;
+
+	static constexpr size_t s_queueCapacity = 1024;
+
+	explicit ScriptWorker(SetupCallback setupCallback);
+	~ScriptWorker();
+
+	// load the script in a new lua state (queued like the callbacks, so it runs after the ones already queued)
+
+	bool LoadScript(const std::string& path);
+
+	// queue the callback of the command, returns false (and drops it) if the queue is full
+
+	bool Submit(std::shared_ptr<const CommandTable> commandTable, uint16_t commandId, unsigned int repeatCount = 1);
+
+	uint64_t GetDroppedCallbacks() const { return m_droppedCallbacks.load(std::memory_order_relaxed); }
+
+	// submitted -> started (microseconds)
+
+	const LatencyHistogram& GetQueueStats() const { return m_queueStats; }
+
+	// execution time of every handler that has run (microseconds)
+
+	void ForEachCallbackStats(const std::function<void(const std::string& function, const LatencyHistogram& execution)>& callback) const;
+
+	void ResetStats();
+
+private:
+	struct Job
+	{
+		std::shared_ptr<const CommandTable> commandTable; // nullptr to load the script
+		uint16_t commandId = 0;
+		unsigned int repeatCount = 0;
+		Clock::time_point submitTime;
+		std::string scriptPath;
+	};
+
+	bool Push(Job job);
+	void Run();
+	void Load(const std::string& path);
+	void Call(const Job& job);
+	LatencyHistogram& GetCallbackStats(const std::string& function);
+
+private:
+	SetupCallback m_setupCallback;
+	MpmcQueue<Job> m_jobs;
+	std::atomic<uint32_t> m_signal; // bumped after every push, the worker waits on it when the queue is empty
+	std::atomic<bool> m_stopping;
+	std::atomic<uint64_t> m_droppedCallbacks;
+	LatencyHistogram m_queueStats;
+
+	// the map only grows, locked by the worker to find the histogram of a handler & by the readers to iterate
+
+	mutable std::mutex m_callbackStatsMutex;
+	std::map<std::string, LatencyHistogram, std::less<>> m_callbackStats;
+
+	lua_State* m_script; // worker thread only
+	std::thread m_thread;
+};
@@ -0,0 +1,19 @@
+#pragma once
+
+#ifdef _WIN32
+
+#include "InputInjector.h"
+
+/* SENDINPUT INJECTOR */
+
+// injects with SendInput, every sequence keeps its INPUT array already repeated s_maxBatchedRepeats times
+// so any repeat count up to that is a single SendInput call on a prefix of the array
+
+class SendInputInjector : public InputInjector
+{
+public:
+	std::shared_ptr<const InputSequence> Compile(std::vector<InputEvent> events) const override;
+	void Inject(const InputSequence& sequence, unsigned int repeatCount) override;
+};
+
+#endif
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include "Action.h"
+#include "InputInjector.h"
+
+/* TIMED MACRO */
+
+// the steps of a TIMED_MACRO flattened into a timeline (repeats unrolled, text turned into key taps) and compiled by
+// the injector, the events at the same time are injected together as one batch
+// the keys still down at the end are released so a macro never leaves a key stuck
+
+class TimedMacro
+{
+public:
+	// longer macros are cut
+
+	static constexpr size_t s_maxEvents = 16384;
+
+	// events to inject at time milliseconds after the start
+
+	struct Batch
+	{
+		uint32_t timeMs;
+		std::shared_ptr<const InputSequence> sequence;
+	};
+
+	TimedMacro(const std::vector<MacroStep>& steps, const InputInjector& inputInjector);
+
+	const std::vector<Batch>& GetBatches() const { return m_batches; }
+
+	// length of the macro in milliseconds, the trailing delays included (a repeat starts right after)
+
+	uint32_t GetDuration() const { return m_duration; }
+
+	// virtual key (us layout) of a character and if shift has to be down, false if it can't be typed
+
+	static bool GetCharacterKey(char character, unsigned char& key, bool& shift);
+
+private:
+	std::vector<Batch> m_batches;
+	uint32_t m_duration = 0;
+};
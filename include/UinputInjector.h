@@ -0,0 +1,27 @@
+#pragma once
+
+#ifdef __linux__
+
+#include "InputInjector.h"
+
+/* UINPUT INJECTOR */
+
+// injects through a virtual keyboard created with /dev/uinput, the virtual keys are translated to linux key codes
+// when the sequence is compiled and every repeat is one iovec of the same events, so an inject is one writev
+
+class UinputInjector : public InputInjector
+{
+public:
+	UinputInjector();
+	~UinputInjector();
+
+	bool IsOpen() const { return m_fd >= 0; }
+
+	std::shared_ptr<const InputSequence> Compile(std::vector<InputEvent> events) const override;
+	void Inject(const InputSequence& sequence, unsigned int repeatCount) override;
+
+private:
+	int m_fd;
+};
+
+#endif
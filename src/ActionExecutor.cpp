@@ -0,0 +1,177 @@
+#include "ActionExecutor.h"
+#include <chrono>
+#include <thread>
+
+extern "C"
+{
+#include <lua.h>
+#include <lauxlib.h>
+}
+
+using Clock = std::chrono::steady_clock;
+
+static uint64_t MicrosecondsBetween(Clock::time_point begin, Clock::time_point end)
+{
+	return std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count();
+}
+
+/* ACTION EXECUTOR */
+
+ActionExecutor::ActionExecutor(std::unique_ptr<InputInjector> inputInjector, std::unique_ptr<ProcessLauncher> processLauncher, int processWorkersCount)
+	: m_inputInjector(std::move(inputInjector)), m_processLauncher(std::move(processLauncher)), m_keyMacroLane(1), m_processWorkers(processWorkersCount),
+	m_macroScheduler([this](const std::shared_ptr<const CommandTable>& commandTable, const InputSequence& sequence) { SubmitSequence(commandTable, sequence); }),
+	m_scriptWorker([this](lua_State* l) { SetupScript(l); })
+{
+}
+
+void ActionExecutor::ResetStats()
+{
+	m_keyMacroStats.queue.Reset();
+	m_keyMacroStats.execution.Reset();
+	m_processStats.queue.Reset();
+	m_processStats.execution.Reset();
+	m_macroScheduler.ResetStats();
+	m_scriptWorker.ResetStats();
+}
+
+void ActionExecutor::Submit(std::shared_ptr<const CommandTable> commandTable, uint16_t commandId, unsigned int repeatCount)
+{
+	const Action& action = commandTable->GetAction(commandId);
+
+	// profile switches are performed by the caller (they must be seen by its next command)
+
+	if (action.type == NONE || action.type == SWITCH_PROFILE)
+		return;
+
+	if (action.type == TIMED_MACRO)
+	{
+		m_macroScheduler.Start(std::move(commandTable), commandId, repeatCount);
+		return;
+	}
+
+	if (action.type == LUA_CALLBACK)
+	{
+		m_scriptWorker.Submit(std::move(commandTable), commandId, repeatCount);
+		return;
+	}
+
+	bool keyMacro = action.type == KEY_MACRO;
+	LaneStats& stats = keyMacro ? m_keyMacroStats : m_processStats;
+	Clock::time_point submitTime = Clock::now();
+
+	Task task = [this, commandTable = std::move(commandTable), commandId, &action, &stats, repeatCount, submitTime]() {
+		Clock::time_point startTime = Clock::now();
+
+		if (action.type == KEY_MACRO)
+		{
+			// one batched inject of the prebuilt events
+
+			const InputSequence* inputSequence = commandTable->GetInputSequence(commandId);
+
+			if (inputSequence)
+				m_inputInjector->Inject(*inputSequence, repeatCount);
+		}
+		else
+		{
+			const PreparedProcess* preparedProcess = commandTable->GetPreparedProcess(commandId);
+
+			for (unsigned int repeat = 0; preparedProcess && repeat < repeatCount; repeat++)
+				m_processLauncher->Launch(*preparedProcess);
+		}
+
+		stats.queue.Record(MicrosecondsBetween(submitTime, startTime));
+		stats.execution.Record(MicrosecondsBetween(startTime, Clock::now()));
+	};
+
+	if (keyMacro)
+		m_keyMacroLane.SubmitTask(task);
+	else
+		m_processWorkers.SubmitTask(task);
+}
+
+void ActionExecutor::SubmitSequence(std::shared_ptr<const void> owner, const InputSequence& sequence)
+{
+	Clock::time_point submitTime = Clock::now();
+
+	m_keyMacroLane.SubmitTask([this, owner = std::move(owner), &sequence, submitTime]() {
+		Clock::time_point startTime = Clock::now();
+
+		m_inputInjector->Inject(sequence, 1);
+
+		m_keyMacroStats.queue.Record(MicrosecondsBetween(submitTime, startTime));
+		m_keyMacroStats.execution.Record(MicrosecondsBetween(startTime, Clock::now()));
+	});
+}
+
+void ActionExecutor::SubmitProcess(std::shared_ptr<const PreparedProcess> preparedProcess)
+{
+	Clock::time_point submitTime = Clock::now();
+
+	m_processWorkers.SubmitTask([this, preparedProcess = std::move(preparedProcess), submitTime]() {
+		Clock::time_point startTime = Clock::now();
+
+		m_processLauncher->Launch(*preparedProcess);
+
+		m_processStats.queue.Record(MicrosecondsBetween(submitTime, startTime));
+		m_processStats.execution.Record(MicrosecondsBetween(startTime, Clock::now()));
+	});
+}
+
+void ActionExecutor::SetupScript(lua_State* l)
+{
+	lua_pushlightuserdata(l, this);
+	lua_pushcclosure(l, KeyMacroLuaWrap, 1);
+	lua_setglobal(l, "key_macro");
+
+	lua_pushlightuserdata(l, this);
+	lua_pushcclosure(l, LaunchLuaWrap, 1);
+	lua_setglobal(l, "launch");
+
+	lua_pushcfunction(l, SleepLuaWrap);
+	lua_setglobal(l, "sleep");
+}
+
+int ActionExecutor::KeyMacroLuaWrap(lua_State* l)
+{
+	ActionExecutor* actionExecutor = (ActionExecutor*)lua_touserdata(l, lua_upvalueindex(1));
+	int numKeys = lua_gettop(l);
+
+	// every argument is checked before any c++ object exists, a lua error longjmps over their destructors
+
+	for (int i = 1; i <= numKeys; i++)
+		luaL_checkinteger(l, i);
+
+	std::vector<unsigned char> keys(numKeys);
+
+	for (int i = 1; i <= numKeys; i++)
+		keys[i - 1] = (unsigned char)lua_tointeger(l, i);
+
+	std::shared_ptr<const InputSequence> sequence = actionExecutor->m_inputInjector->Compile(InputInjector::BuildKeyMacroEvents(keys));
+	const InputSequence& events = *sequence;
+
+	actionExecutor->SubmitSequence(std::move(sequence), events);
+
+	return 0;
+}
+
+int ActionExecutor::LaunchLuaWrap(lua_State* l)
+{
+	ActionExecutor* actionExecutor = (ActionExecutor*)lua_touserdata(l, lua_upvalueindex(1));
+	std::shared_ptr<const PreparedProcess> preparedProcess = actionExecutor->m_processLauncher->Prepare(luaL_checkstring(l, 1));
+
+	if (preparedProcess)
+		actionExecutor->SubmitProcess(std::move(preparedProcess));
+
+	lua_pushboolean(l, preparedProcess != nullptr);
+
+	return 1;
+}
+
+int ActionExecutor::SleepLuaWrap(lua_State* l)
+{
+	// only the script worker waits
+
+	std::this_thread::sleep_for(std::chrono::milliseconds(luaL_checkinteger(l, 1)));
+
+	return 0;
+}
@@ -1,29 +1,33 @@
 #include "ArduinoMacroPadController.h"
+#include "LuaLedBuffer.h"
+#include "LuaScriptCache.h"
 #include <imgui/imgui.h>
 #include <Windows.h>
 #include <iostream>
 #include <vector>
+#include <algorithm>
 #include <fstream>
+#include <filesystem>
 #include <nlohmann/json.hpp>
 #include <imgui/imgui.h>
 
 using namespace nlohmann; // for using json instead of nlohmann::json
 
-static const std::string g_actionTypeStr = "action_type";
-static const std::string g_keysStr = "keys";
-static const std::string g_processPathStr = "process_path";
+// fields of the lua set_effect table (the names of the led_effect of the config)
 
-static std::unordered_map<ActionType, std::string> g_actionTypeToStringMap = {
-    { ActionType::NONE        , "none"         },
-    { ActionType::KEY_MACRO   , "key_macro"    },
-    { ActionType::OPEN_PROCESS, "open_process" }
-};
+static const std::string g_speedStr = "speed";
+static const std::string g_frequencyStr = "frequency";
+static const std::string g_colorStr = "color";
+static const std::string g_color2Str = "color2";
+static const std::string g_shaderStr = "shader";
 
-static std::unordered_map<std::string, ActionType> g_stringToActionTypeMap = {
-    { "none"     ,    ActionType::NONE         },
-    { "key_macro",    ActionType::KEY_MACRO    },
-    { "open_process", ActionType::OPEN_PROCESS }
-};
+// config loaded at startup (commands, profiles, led effect & geometry)
+
+static const std::string g_configPath = "config.json";
+
+// script of the SCRIPT led effect (update_leds)
+
+static const std::string g_ledScriptPath = "assets/scripts/rainbow.lua";
 
 static bool CheckLua(lua_State* l, int r)
 {
@@ -38,182 +42,132 @@ static bool CheckLua(lua_State* l, int r)
     return true;
 }
 
-static void SerializeAction(const std::string& commandName, const Action& action, json& jsonConfigFile)
-{
-    jsonConfigFile[commandName][g_actionTypeStr] = g_actionTypeToStringMap[action.type];
-    
-    switch (action.type)
-    {
-    case KEY_MACRO:
-        jsonConfigFile[commandName][g_keysStr] = action.keys;
-        break;
-    case OPEN_PROCESS:
-        jsonConfigFile[commandName][g_processPathStr] = action.processPath;
-        break;
-    }
-}
+// percentiles & non empty buckets of a latency histogram
 
-static Action DeserializeAction(const std::string& commandName, const json& jsonConfigFile)
+static json SerializeLatencyHistogram(const LatencyHistogram& histogram)
 {
-    Action action;
-    action.type = g_stringToActionTypeMap[jsonConfigFile[commandName][g_actionTypeStr]];
+    json jsonHistogram;
 
-    switch (action.type)
-    {
-    case KEY_MACRO:
-        action.keys = jsonConfigFile[commandName][g_keysStr].get<std::vector<unsigned char>>();
-        break;
-    case OPEN_PROCESS:
-        action.processPath = jsonConfigFile[commandName][g_processPathStr];
-        break;
-    }
+    jsonHistogram["count"] = histogram.GetCount();
+    jsonHistogram["mean"] = histogram.GetMean();
+    jsonHistogram["p50"] = histogram.GetPercentile(50.0);
+    jsonHistogram["p90"] = histogram.GetPercentile(90.0);
+    jsonHistogram["p99"] = histogram.GetPercentile(99.0);
+    jsonHistogram["p999"] = histogram.GetPercentile(99.9);
+    jsonHistogram["max"] = histogram.GetMax();
 
-    return action;
-}
-
-static void OpenProcess(const std::string& path)
-{
-    STARTUPINFOA si;
-    PROCESS_INFORMATION pi;
-    ZeroMemory(&si, sizeof(si));
-    ZeroMemory(&pi, sizeof(pi));
-    si.cb = sizeof(si);
-
-    // create c str path
+    json buckets = json::array();
 
-    char* pathCStr = new char[path.size() + 1];
-    strncpy_s(pathCStr, path.size() + 1, path.c_str(), path.size());
-    pathCStr[path.size()] = '\0';
+    for (size_t i = 0; i < LatencyHistogram::s_numBuckets; i++)
+    {
+        uint64_t count = histogram.GetBucketCount(i);
 
-    // Create the process
+        if (count != 0)
+            buckets.push_back({ LatencyHistogram::GetBucketLowerBound(i), LatencyHistogram::GetBucketUpperBound(i), count });
+    }
 
-    BOOL result = CreateProcessA(NULL, pathCStr, NULL, NULL, FALSE, 0, NULL, NULL, &si, &pi);
+    jsonHistogram["buckets"] = buckets;
 
-    // clean c str path
+    return jsonHistogram;
+}
 
-    delete[] pathCStr;
+// fields of the lua table at index (the missing ones are left as they are)
 
-    // Check the result
+static void GetLuaNumberField(lua_State* l, int index, const char* name, float& value)
+{
+    if (lua_getfield(l, index, name) == LUA_TNUMBER)
+        value = (float)lua_tonumber(l, -1);
 
-    if (result)
-    {
-        // Close process and thread handles
-        
-        CloseHandle(pi.hProcess);
-        CloseHandle(pi.hThread);
+    lua_pop(l, 1);
+}
 
-        std::cout << "Process: " << path << " opened succesfully" << std::endl;
-    }
-    else
-    {
-        // Failed to create the process
-        // Handle the error accordingly
+static void GetLuaStringField(lua_State* l, int index, const char* name, std::string& value)
+{
+    if (lua_getfield(l, index, name) == LUA_TSTRING)
+        value = lua_tostring(l, -1);
 
-        std::cout << "Process: " << path << " couldn't be opened" << std::endl;
-    }
+    lua_pop(l, 1);
 }
 
-static void PerformAction(const Action& action)
+static void GetLuaColorField(lua_State* l, int index, const char* name, std::array<uint8_t, 3>& color)
 {
-    switch (action.type)
+    if (lua_getfield(l, index, name) == LUA_TTABLE)
     {
-    case KEY_MACRO:
-    {
-        int numKeys = action.keys.size();
-        INPUT* inputs = new INPUT[numKeys * 2];
-        ZeroMemory(inputs, numKeys * 2 * sizeof(INPUT));
-
-        // key presses
-
-        for (int i = 0; i < numKeys; i++)
-        {
-            inputs[i].type = INPUT_KEYBOARD;
-            inputs[i].ki.wVk = action.keys[i];
-        }
-
-        // key releases in the reverse order
-
-        for (int i = numKeys - 1; i >= 0; i--)
+        for (int i = 0; i < 3; i++)
         {
-            int padding = numKeys + i;
+            if (lua_geti(l, -1, i + 1) == LUA_TNUMBER)
+                color[i] = (uint8_t)lua_tointeger(l, -1);
 
-            inputs[padding].type = INPUT_KEYBOARD;
-            inputs[padding].ki.wVk = action.keys[i];
-            inputs[padding].ki.dwFlags = KEYEVENTF_KEYUP;
+            lua_pop(l, 1);
         }
-
-        // send the input
-
-        SendInput(numKeys * 2, inputs, sizeof(INPUT));
-        
-        // clean
-
-        delete[] inputs;
-    }
-    break;
-    case OPEN_PROCESS:
-        OpenProcess(action.processPath);
-        break;
     }
+
+    lua_pop(l, 1);
 }
 
 /* Arduino macro pad controller class */
 
 ArduinoMacroPadController::ArduinoMacroPadController()
-    : m_port(m_io), m_baudios(9600)
+    : m_deviceManager(2), m_ledEffectEngine(LedGeometry::s_defaultWidth, LedGeometry::s_defaultHeight)
 {
-    // init leds color to be purple
+    // leds of the default geometry (the config can change it), init leds color to be purple
 
-    for (int i = 0; i < 441; i++)
+    SetLedGeometry(m_ledGeometry);
+
+    for (size_t i = 0; i < m_leds.GetNumLeds(); i++)
     {
-        m_ledsData[i] = { 175, 45, 246 };
+        m_leds[i] = { 175, 45, 246 };
     }
 
     m_time = 0.0f;
 
     /* Define commands */
 
+    m_foregroundPollTime = 0.0f;
+
+    CommandsMap& commandsMap = m_profiles[Config::s_defaultProfile].commandsMap;
+
     // increment volume action
 
     Action incrementVolumeAction;
     incrementVolumeAction.type = ActionType::KEY_MACRO;
     incrementVolumeAction.keys = { VK_VOLUME_UP };
-    m_commandsMap["VOLUMEUP"] = incrementVolumeAction;
+    commandsMap["VOLUMEUP"] = incrementVolumeAction;
 
     // decrement volume action
 
     Action decrementVolumeAction;
     decrementVolumeAction.type = ActionType::KEY_MACRO;
     decrementVolumeAction.keys = { VK_VOLUME_DOWN };
-    m_commandsMap["VOLUMEDOWN"] = decrementVolumeAction;
+    commandsMap["VOLUMEDOWN"] = decrementVolumeAction;
 
     // next track action
 
     Action nextTrackAction;
     nextTrackAction.type = ActionType::KEY_MACRO;
     nextTrackAction.keys = { VK_MEDIA_NEXT_TRACK };
-    m_commandsMap["NEXTTRACK"] = nextTrackAction;
+    commandsMap["NEXTTRACK"] = nextTrackAction;
 
     // prev track action
 
     Action prevTrackAction;
     prevTrackAction.type = ActionType::KEY_MACRO;
     prevTrackAction.keys = { VK_MEDIA_PREV_TRACK };
-    m_commandsMap["PREVTRACK"] = prevTrackAction;
+    commandsMap["PREVTRACK"] = prevTrackAction;
 
     // play pause action
 
     Action playPauseAction;
     playPauseAction.type = ActionType::KEY_MACRO;
     playPauseAction.keys = { VK_MEDIA_PLAY_PAUSE };
-    m_commandsMap["PLAYPAUSE"] = playPauseAction;
+    commandsMap["PLAYPAUSE"] = playPauseAction;
 
     // mute action
 
     Action muteAction;
     muteAction.type = ActionType::KEY_MACRO;
     muteAction.keys = { VK_VOLUME_MUTE };
-    m_commandsMap["MUTE"] = muteAction;
+    commandsMap["MUTE"] = muteAction;
 
     // each key of the macro pad
 
@@ -222,17 +176,36 @@ ArduinoMacroPadController::ArduinoMacroPadController()
         Action keyAction;
         keyAction.type = ActionType::OPEN_PROCESS;
         keyAction.processPath = "C:/Users/5davi/AppData/Roaming/Spotify/Spotify.exe";
-        m_commandsMap["KEY" + std::to_string(i)] = keyAction;
+        commandsMap["KEY" + std::to_string(i)] = keyAction;
     }
 
     Action keyAction;
     keyAction.type = ActionType::KEY_MACRO;
     keyAction.keys = { VK_LWIN, VK_SHIFT, (int)'S'}; // screenshot
-    m_commandsMap["KEY" + std::to_string(5)] = keyAction;
+    commandsMap["KEY" + std::to_string(5)] = keyAction;
 
     // SerializeConfig("config.json");
 
-    // DeserializeConfig("config.json");
+    // the config file is merged over the built-in commands (and sets the profiles, the led effect & the geometry), the
+    // built-in commands are kept when there is no config or it can't be read
+
+    bool configLoaded = false;
+
+    if (std::filesystem::exists(g_configPath))
+    {
+        try
+        {
+            DeserializeConfig(g_configPath);
+            configLoaded = true;
+        }
+        catch (const json::exception& e)
+        {
+            std::cerr << "[WARNING] The config " << g_configPath << " couldn't be loaded: " << e.what() << std::endl;
+        }
+    }
+
+    if (!configLoaded)
+        CompileCommands();
 
     /* LUA TESTING */
 
@@ -241,22 +214,20 @@ ArduinoMacroPadController::ArduinoMacroPadController()
     m_script = luaL_newstate();
     luaL_openlibs(m_script);
 
-    // Step 2: Load and execute the Lua script
+    // Step 2: Load and execute the Lua script (from the bytecode cache when it hasn't changed)
 
-    if (CheckLua(m_script, luaL_dofile(m_script, "assets/scripts/rainbow.lua"))) // if it fails do smth
+    if (CheckLua(m_script, LuaScriptCache::DoFile(m_script, g_ledScriptPath))) // if it fails do smth
     {
 
     }
 
     // Step 3: Expose this instance and functions to Lua
 
-    lua_pushlightuserdata(m_script, this);
-    lua_pushcclosure(m_script, SetLedColorLuaWrap, 1);
-    lua_setglobal(m_script, "set_led");
+    RegisterLuaFunctions(m_script);
+
+    // the lua callbacks run in their own state on the script worker of the executor
 
-    lua_pushlightuserdata(m_script, this);
-    lua_pushcclosure(m_script, GetLedColorLuaWrap, 1);
-    lua_setglobal(m_script, "get_led");
+    m_deviceManager.GetActionExecutor().GetScriptWorker().LoadScript("assets/scripts/callbacks.lua");
 }
 
 ArduinoMacroPadController::~ArduinoMacroPadController()
@@ -268,104 +239,166 @@ ArduinoMacroPadController::~ArduinoMacroPadController()
 
 void ArduinoMacroPadController::ConnectToPort(const std::string& portName, unsigned int baudios)
 {
-    m_portName = portName;
-    m_baudios = baudios;
+    m_deviceManager.AddDevice(portName, baudios);
+}
 
-    // open serial port & start the command listener thread
+void ArduinoMacroPadController::Disconnect()
+{
+    m_deviceManager.RemoveAllDevices();
+}
 
-    try
-    {
-        m_port.open(portName);
-        m_port.set_option(asio::serial_port_base::baud_rate(m_baudios)); // Set baud rate to match Arduino
+void ArduinoMacroPadController::SerializeConfig(const std::string& path) const
+{
+    Config config;
+    config.profiles = m_profiles;
+    config.activeProfile = GetProfile();
+    config.ledEffect = GetLedEffect();
+    config.ledGeometry = m_ledGeometry;
 
-        m_listenerThread = std::thread([this]() {
-            CommandListenerProcess();
-        });
-    }
-    catch (const asio::system_error& e)
-    {
-        std::cerr << "Error: " << e.what() << std::endl;
-    }
+    config.Save(path);
 }
 
-void ArduinoMacroPadController::Disconnect()
+void ArduinoMacroPadController::DeserializeConfig(const std::string& path)
 {
-    if (m_port.is_open())
+    Config config = Config::Load(path);
+
+    // the commands are merged into the profiles that already exist
+
+    for (auto& [profileName, configProfile] : config.profiles)
     {
-        m_port.close();
+        Config::Profile& profile = m_profiles[profileName];
+
+        for (auto& [commandName, action] : configProfile.commandsMap)
+        {
+            profile.commandsMap[commandName] = std::move(action);
+        }
+
+        profile.applications = std::move(configProfile.applications);
     }
+
+    CompileCommands();
+
+    if (!config.activeProfile.empty())
+        SetProfile(config.activeProfile);
+
+    if (config.ledEffect)
+        SetLedEffect(*config.ledEffect);
+
+    if (config.ledGeometry)
+        SetLedGeometry(*config.ledGeometry);
 }
 
-void ArduinoMacroPadController::SerializeConfig(const std::string& path) const
+void ArduinoMacroPadController::CompileCommands()
 {
-    json configFile;
+    // every profile is compiled (for the injector & launcher of the executor) and published at once, the connected devices
+    // pick the new table of the active profile on their next command
+
+    const ActionExecutor& actionExecutor = m_deviceManager.GetActionExecutor();
+    std::vector<ProfileManager::Profile> profiles;
 
-    for (const auto& [commandName, action] : m_commandsMap)
+    for (const auto& [profileName, profile] : m_profiles)
     {
-        SerializeAction(commandName, action, configFile);
+        profiles.push_back({ profileName, std::make_shared<const CommandTable>(profile.commandsMap, &actionExecutor.GetInputInjector(), &actionExecutor.GetProcessLauncher()) });
     }
 
-    std::ofstream file(path);
-    file << std::setw(4) << configFile;
+    m_deviceManager.GetProfileManager().SetProfiles(std::move(profiles));
 }
 
-void ArduinoMacroPadController::DeserializeConfig(const std::string& path)
+void ArduinoMacroPadController::SetLedGeometry(const LedGeometry& geometry)
 {
-    std::ifstream file(path);
-    json configFile = json::parse(file);
+    // the lua led buffers read the size & storage through the members, so they follow without registering them again
 
-    for (auto& element : configFile.items())
-    {
-        const std::string& commandName = element.key();
-        Action action = DeserializeAction(commandName, configFile);
-        m_commandsMap[commandName] = action;
-    }
+    m_ledGeometry = geometry;
+    m_leds.Resize(geometry.GetNumLeds());
+    m_wiredLeds.Resize(geometry.IsMatrixOrder() ? 0 : geometry.GetNumWiredLeds());
+    m_ledEffectEngine.SetGeometry(geometry.GetWidth(), geometry.GetHeight());
+
+    // loaded again with the new size on the next update
+
+    m_gpuLedEffect.Unload();
+}
+
+void ArduinoMacroPadController::RegisterLuaFunctions(lua_State* l)
+{
+    lua_pushlightuserdata(l, this);
+    lua_pushcclosure(l, SetLedColorLuaWrap, 1);
+    lua_setglobal(l, "set_led");
+
+    lua_pushlightuserdata(l, this);
+    lua_pushcclosure(l, GetLedColorLuaWrap, 1);
+    lua_setglobal(l, "get_led");
+
+    lua_pushlightuserdata(l, this);
+    lua_pushcclosure(l, SetProfileLuaWrap, 1);
+    lua_setglobal(l, "set_profile");
+
+    lua_pushlightuserdata(l, this);
+    lua_pushcclosure(l, GetProfileLuaWrap, 1);
+    lua_setglobal(l, "get_profile");
+
+    lua_pushlightuserdata(l, this);
+    lua_pushcclosure(l, SetLedEffectLuaWrap, 1);
+    lua_setglobal(l, "set_effect");
+
+    lua_pushlightuserdata(l, this);
+    lua_pushcclosure(l, GetLedEffectLuaWrap, 1);
+    lua_setglobal(l, "get_effect");
+
+    // the leds as one buffer (leds[i], leds:fill(color), ...)
+
+    LuaLedBuffer::Register(l, "leds", m_leds, m_ledGeometry);
 }
 
-void ArduinoMacroPadController::ProcessCommand(const std::string& command) const
+void ArduinoMacroPadController::DumpLatencyStats(const std::string& path) const
 {
-    auto it = m_commandsMap.find(command);
+    json latencyFile;
 
-    if (it != m_commandsMap.end())
+    for (const auto& device : m_deviceManager.GetDevices())
     {
-        const Action& action = it->second;
+        const MacroPadDevice::LatencyStats& latencyStats = device->GetLatencyStats();
+        json& jsonDevice = latencyFile[device->GetPortName()];
 
-        PerformAction(action);
+        jsonDevice["clock_offset_us"] = device->HasClockOffset() ? json(device->GetClockOffset()) : json(nullptr);
+        jsonDevice["receive"] = SerializeLatencyHistogram(latencyStats.receive);
+        jsonDevice["parse"] = SerializeLatencyHistogram(latencyStats.parse);
+        jsonDevice["dispatch"] = SerializeLatencyHistogram(latencyStats.dispatch);
     }
+
+    const ActionExecutor& actionExecutor = m_deviceManager.GetActionExecutor();
+
+    latencyFile["executor"]["key_macro"]["queue"] = SerializeLatencyHistogram(actionExecutor.GetKeyMacroStats().queue);
+    latencyFile["executor"]["key_macro"]["execution"] = SerializeLatencyHistogram(actionExecutor.GetKeyMacroStats().execution);
+    latencyFile["executor"]["open_process"]["queue"] = SerializeLatencyHistogram(actionExecutor.GetProcessStats().queue);
+    latencyFile["executor"]["open_process"]["execution"] = SerializeLatencyHistogram(actionExecutor.GetProcessStats().execution);
+    latencyFile["executor"]["timed_macro"]["jitter"] = SerializeLatencyHistogram(actionExecutor.GetMacroScheduler().GetJitter());
+    latencyFile["executor"]["lua_callback"]["queue"] = SerializeLatencyHistogram(actionExecutor.GetScriptWorker().GetQueueStats());
+    latencyFile["executor"]["lua_callback"]["dropped"] = actionExecutor.GetScriptWorker().GetDroppedCallbacks();
+
+    actionExecutor.GetScriptWorker().ForEachCallbackStats([&](const std::string& function, const LatencyHistogram& execution) {
+        latencyFile["executor"]["lua_callback"]["execution"][function] = SerializeLatencyHistogram(execution);
+    });
+
+    std::ofstream file(path);
+    file << std::setw(4) << latencyFile;
 }
 
-void ArduinoMacroPadController::CommandListenerProcess()
+void ArduinoMacroPadController::ProcessCommand(std::string_view command)
 {
-    char buffer; // Buffer to hold received data
-    size_t bytesRead = 0; // Number of bytes read
-    std::string command;
-    bool running = true;
+    std::shared_ptr<const CommandTable> commandTable = m_deviceManager.GetProfileManager().GetActiveTable();
+    uint16_t commandId = commandTable->Find(command);
 
-    while (running)
-    {
-        try
-        {
-            bytesRead = asio::read(m_port, asio::buffer(&buffer, 1));
+    if (commandId == CommandTable::s_invalidId)
+        return;
 
-            if (bytesRead > 0)
-            {
-                if (buffer == '\n')
-                {
-                    std::cout << "Command received: " << command << std::endl;
-
-                    ProcessCommand(command);
-                    command.clear();
-                }
-                else
-                {
-                    command += buffer;
-                }
-            }
-        }
-        catch (const asio::system_error& e)
-        {
-            running = false;
-        }
+    const Action& action = commandTable->GetAction(commandId);
+
+    if (action.type == SWITCH_PROFILE)
+    {
+        SetProfile(action.profileName);
+    }
+    else
+    {
+        m_deviceManager.GetActionExecutor().Submit(commandTable, commandId);
     }
 }
 
@@ -391,28 +424,158 @@ int ArduinoMacroPadController::GetLedColorLuaWrap(lua_State* l)
     return 3;
 }
 
+int ArduinoMacroPadController::SetProfileLuaWrap(lua_State* l)
+{
+    ArduinoMacroPadController* macroPadController = (ArduinoMacroPadController*)lua_touserdata(l, lua_upvalueindex(1));
+    std::string name = luaL_checkstring(l, 1);
+    lua_pushboolean(l, macroPadController->SetProfile(name));
+    return 1;
+}
+
+int ArduinoMacroPadController::GetProfileLuaWrap(lua_State* l)
+{
+    ArduinoMacroPadController* macroPadController = (ArduinoMacroPadController*)lua_touserdata(l, lua_upvalueindex(1));
+    lua_pushstring(l, macroPadController->GetProfile().c_str());
+    return 1;
+}
+
+int ArduinoMacroPadController::SetLedEffectLuaWrap(lua_State* l)
+{
+    // set_effect(name [, { speed = , frequency = , color = { r, g, b }, color2 = { r, g, b }, shader = path }])
+
+    ArduinoMacroPadController* macroPadController = (ArduinoMacroPadController*)lua_touserdata(l, lua_upvalueindex(1));
+    LedEffect effect;
+
+    if (!Config::FindLedEffectType(luaL_checkstring(l, 1), effect.type))
+    {
+        lua_pushboolean(l, false);
+        return 1;
+    }
+
+    if (lua_istable(l, 2))
+    {
+        GetLuaNumberField(l, 2, g_speedStr.c_str(), effect.speed);
+        GetLuaNumberField(l, 2, g_frequencyStr.c_str(), effect.frequency);
+        GetLuaColorField(l, 2, g_colorStr.c_str(), effect.color);
+        GetLuaColorField(l, 2, g_color2Str.c_str(), effect.color2);
+        GetLuaStringField(l, 2, g_shaderStr.c_str(), effect.shaderPath);
+    }
+
+    macroPadController->SetLedEffect(effect);
+    lua_pushboolean(l, true);
+    return 1;
+}
+
+int ArduinoMacroPadController::GetLedEffectLuaWrap(lua_State* l)
+{
+    ArduinoMacroPadController* macroPadController = (ArduinoMacroPadController*)lua_touserdata(l, lua_upvalueindex(1));
+    lua_pushstring(l, Config::GetLedEffectTypeName(macroPadController->GetLedEffect().type).c_str());
+    return 1;
+}
+
+void ArduinoMacroPadController::UpdateForegroundProfile()
+{
+    // executable name of the focused window
+
+    std::string application;
+    HWND window = GetForegroundWindow();
+    DWORD processId = 0;
+
+    if (window)
+        GetWindowThreadProcessId(window, &processId);
+
+    HANDLE process = processId ? OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, processId) : nullptr;
+
+    if (process)
+    {
+        char path[MAX_PATH];
+        DWORD size = MAX_PATH;
+
+        if (QueryFullProcessImageNameA(process, 0, path, &size))
+        {
+            application = std::string(path, size);
+            application = application.substr(application.find_last_of("\\/") + 1);
+        }
+
+        CloseHandle(process);
+    }
+
+    // only when the focus changes, so a profile switched by hand stays until another application is focused
+
+    if (application.empty() || application == m_foregroundApplication)
+        return;
+
+    m_foregroundApplication = application;
+
+    for (const auto& [profileName, profile] : m_profiles)
+    {
+        for (const std::string& profileApplication : profile.applications)
+        {
+            if (_stricmp(profileApplication.c_str(), application.c_str()) == 0)
+            {
+                SetProfile(profileName);
+                return;
+            }
+        }
+    }
+}
+
 void ArduinoMacroPadController::Update(float delta)
 {
-    // TODO: modify led color by lua script (execute update_leds function)
+    // per application profiles
 
-    lua_getglobal(m_script, "update_leds");
+    m_foregroundPollTime -= delta;
 
-    if (lua_isfunction(m_script, -1))
+    if (m_foregroundPollTime <= 0.0f)
     {
-        lua_pushnumber(m_script, m_time);
+        UpdateForegroundProfile();
+        m_foregroundPollTime = s_foregroundPollInterval;
+    }
+
+    // leds by the gpu (a frame late), the native effect or the lua script (execute update_leds function)
 
-        if (CheckLua(m_script, lua_pcall(m_script, 1, 0, 0)))
+    const LedEffect& ledEffect = GetLedEffect();
+
+    if (ledEffect.type == LedEffectType::SHADER)
+    {
+        if (m_gpuLedEffect.GetPath() != ledEffect.shaderPath)
+            m_gpuLedEffect.Load(ledEffect.shaderPath, m_ledGeometry.GetWidth(), m_ledGeometry.GetHeight());
+
+        m_gpuLedEffect.Render(m_time, m_leds.GetData());
+    }
+    else if (m_ledEffectEngine.IsNative())
+    {
+        m_ledEffectEngine.Render(m_time, m_leds.GetData());
+    }
+    else
+    {
+        lua_getglobal(m_script, "update_leds");
+
+        if (lua_isfunction(m_script, -1))
         {
+            lua_pushnumber(m_script, m_time);
+
+            if (CheckLua(m_script, lua_pcall(m_script, 1, 0, 0)))
+            {
 
+            }
+        }
+        else
+        {
+            lua_pop(m_script, 1);
         }
     }
 
-    // write the led data to the arduino (if it is connected)
+    // publish the led data to the connected macro pads in wiring order (never blocks)
 
-    if (m_port.is_open())
+    if (m_ledGeometry.IsMatrixOrder())
+    {
+        m_deviceManager.PublishLeds(m_leds.GetData(), m_leds.GetSize());
+    }
+    else
     {
-        asio::write(m_port, asio::buffer("LEDSDATA\n"));
-        asio::write(m_port, asio::buffer(m_ledsData, 441 * 3));
+        m_ledGeometry.ToWiringOrder(m_leds.GetData(), m_wiredLeds.GetData());
+        m_deviceManager.PublishLeds(m_wiredLeds.GetData(), m_wiredLeds.GetSize());
     }
 
     // increment time
@@ -426,41 +589,250 @@ void ArduinoMacroPadController::RenderImGui()
 
     ImGui::Begin("Leds Colors");
 
-    static float ledDataNormalized[441 * 3];
+    // the matrix of the geometry drawn as rectangles (one item for the whole matrix, so thousands of leds stay cheap)
+    // with the per key groups outlined
 
-    for (int i = 0; i < 441; i++)
+    int ledsWidth = m_ledGeometry.GetWidth();
+    int ledsHeight = m_ledGeometry.GetHeight();
+    float cellSize = std::clamp(441.0f / std::max(ledsWidth, ledsHeight), 2.0f, 22.0f);
+    float cellGap = cellSize >= 8.0f ? 2.0f : 0.0f;
+
+    ImVec2 origin = ImGui::GetCursorScreenPos();
+    ImDrawList* drawList = ImGui::GetWindowDrawList();
+
+    for (int j = 0; j < ledsHeight; j++)
+    {
+        for (int i = 0; i < ledsWidth; i++)
+        {
+            const led_t& led = m_leds[i + j * ledsWidth];
+            ImVec2 min(origin.x + i * cellSize, origin.y + j * cellSize);
+            drawList->AddRectFilled(min, ImVec2(min.x + cellSize - cellGap, min.y + cellSize - cellGap), IM_COL32(led.r, led.g, led.b, 255), cellGap);
+        }
+    }
+
+    for (const LedGroup& group : m_ledGeometry.GetGroups())
+    {
+        ImVec2 min(origin.x + group.x * cellSize - 1.0f, origin.y + group.y * cellSize - 1.0f);
+        drawList->AddRect(min, ImVec2(min.x + group.width * cellSize, min.y + group.height * cellSize), IM_COL32(255, 255, 255, 160));
+    }
+
+    ImGui::Dummy(ImVec2(ledsWidth * cellSize, ledsHeight * cellSize));
+
+    if (ImGui::IsItemHovered())
     {
-        ledDataNormalized[i * 3 + 0] = m_ledsData[i].r / 255.0f;
-        ledDataNormalized[i * 3 + 1] = m_ledsData[i].g / 255.0f;
-        ledDataNormalized[i * 3 + 2] = m_ledsData[i].b / 255.0f;
+        int x = std::clamp((int)((ImGui::GetMousePos().x - origin.x) / cellSize), 0, ledsWidth - 1);
+        int y = std::clamp((int)((ImGui::GetMousePos().y - origin.y) / cellSize), 0, ledsHeight - 1);
+        ImGui::SetTooltip("led %d (%d, %d)", x + y * ledsWidth, x, y);
     }
 
-    for (int j = 0; j < 21; j++)
+    ImGui::Text("%dx%d leds, %zu wired on %zu panels", ledsWidth, ledsHeight, m_ledGeometry.GetNumWiredLeds(), m_ledGeometry.GetPanels().size());
+
+    // led effect (native or the lua script)
+
+    LedEffect ledEffect = GetLedEffect();
+    bool ledEffectChanged = false;
+
+    if (ImGui::BeginCombo("Effect", Config::GetLedEffectTypeName(ledEffect.type).c_str()))
     {
-        ImGui::NewLine();
-        for (int i = 0; i < 21; i++)
+        for (int type = (int)LedEffectType::SCRIPT; type <= (int)LedEffectType::SHADER; type++)
         {
-            int index = i + j * 21;
-            ImGui::SameLine();
-            ImGui::PushStyleColor(ImGuiCol_Button, ImVec4(ledDataNormalized[index * 3], ledDataNormalized[index * 3 + 1], ledDataNormalized[index * 3 + 2], 1.0f));
-            ImGui::PushStyleVar(ImGuiStyleVar_FrameBorderSize, 0.0f);
-            ImGui::PushStyleVar(ImGuiStyleVar_FrameRounding, 2.0f);
-            ImGui::PushID(index);
-            ImGui::Button("", ImVec2(20, 20));
-            ImGui::PopID();
-            ImGui::PopStyleVar(2);
-            //ImGui::Button(std::string("KEY" + std::to_string(index)).c_str(), ImVec2(20, 20));
-            ImGui::PopStyleColor();
+            if (ImGui::Selectable(Config::GetLedEffectTypeName((LedEffectType)type).c_str(), type == (int)ledEffect.type))
+            {
+                ledEffect.type = (LedEffectType)type;
+                ledEffectChanged = true;
+            }
         }
+
+        ImGui::EndCombo();
     }
 
-    for (int i = 0; i < 441; i++)
+    float ledEffectColors[2][3];
+
+    for (int i = 0; i < 3; i++)
+    {
+        ledEffectColors[0][i] = ledEffect.color[i] / 255.0f;
+        ledEffectColors[1][i] = ledEffect.color2[i] / 255.0f;
+    }
+
+    ledEffectChanged |= ImGui::DragFloat("Speed", &ledEffect.speed, 0.01f);
+    ledEffectChanged |= ImGui::DragFloat("Frequency", &ledEffect.frequency, 0.01f);
+    ledEffectChanged |= ImGui::ColorEdit3("Color", ledEffectColors[0]);
+    ledEffectChanged |= ImGui::ColorEdit3("Color 2", ledEffectColors[1]);
+
+    if (ledEffect.type == LedEffectType::SHADER)
+    {
+        char shaderPath[256];
+        snprintf(shaderPath, sizeof(shaderPath), "%s", ledEffect.shaderPath.c_str());
+
+        if (ImGui::InputText("Shader", shaderPath, sizeof(shaderPath), ImGuiInputTextFlags_EnterReturnsTrue))
+        {
+            ledEffect.shaderPath = shaderPath;
+            ledEffectChanged = true;
+        }
+
+        // unloaded, so the next update compiles it again (after editing the shader)
+
+        if (ImGui::Button("Reload shader"))
+            m_gpuLedEffect.Unload();
+
+        ImGui::SameLine();
+        ImGui::TextUnformatted(m_gpuLedEffect.IsLoaded() ? "running on the gpu" : "not loaded");
+    }
+
+    if (ledEffectChanged)
+    {
+        for (int i = 0; i < 3; i++)
+        {
+            ledEffect.color[i] = (uint8_t)(ledEffectColors[0][i] * 255.0f + 0.5f);
+            ledEffect.color2[i] = (uint8_t)(ledEffectColors[1][i] * 255.0f + 0.5f);
+        }
+
+        SetLedEffect(ledEffect);
+    }
+
+    // active profile (switched here, by a command, from lua or by the focused application)
+
+    const ProfileManager& profileManager = m_deviceManager.GetProfileManager();
+    std::string activeProfile = profileManager.GetActiveProfile();
+
+    if (ImGui::BeginCombo("Profile", activeProfile.c_str()))
+    {
+        for (const std::string& profileName : profileManager.GetProfileNames())
+        {
+            if (ImGui::Selectable(profileName.c_str(), profileName == activeProfile))
+                SetProfile(profileName);
+        }
+
+        ImGui::EndCombo();
+    }
+
+    ImGui::Text("Profile switches: %llu, focused application: %s", (unsigned long long)profileManager.GetSwitchCount(), m_foregroundApplication.c_str());
+
+    // led frame stats of every connected macro pad
+
+    static const char* frameTypeNames[] = { "", "full", "rle", "delta", "full565", "palette" };
+    static const char* encodingNames[] = { "full", "delta", "quantized" };
+    static const char* colorFormatNames[] = { "rgb888", "rgb565", "palette" };
+
+    for (const auto& device : m_deviceManager.GetDevices())
+    {
+        LedFrameEncoder& frameEncoder = device->GetFrameEncoder();
+        const LedFrameScheduler& frameScheduler = device->GetFrameScheduler();
+
+        ImGui::PushID(device.get());
+        ImGui::Separator();
+        ImGui::TextUnformatted(device->GetPortName().c_str());
+        ImGui::Text("Baud: %u (base %u), device: %u leds, max %u baud", device->GetBaudRate(), device->GetBaseBaudRate(), device->GetDeviceNumLeds(), device->GetDeviceMaxBaudRate());
+
+        // the firmware drops the frames that aren't its number of leds
+
+        if (device->GetDeviceNumLeds() && device->GetDeviceNumLeds() != m_ledGeometry.GetNumWiredLeds())
+        {
+            ImGui::Text("[WARNING] the led geometry has %zu wired leds", m_ledGeometry.GetNumWiredLeds());
+        }
+
+        int colorFormat = (int)frameEncoder.GetColorFormat();
+
+        if (ImGui::Combo("Color format", &colorFormat, colorFormatNames, 3))
+        {
+            frameEncoder.SetColorFormat((LedColorFormat)colorFormat);
+        }
+
+        ImGui::Text("Frame: %zu bytes (%s), %.1f dB", frameEncoder.GetLastFrameSize(), frameTypeNames[(int)frameEncoder.GetLastFrameType()], frameEncoder.GetLastFramePsnr());
+        ImGui::Text("Link: %.0f bytes/s, %s encoding, %.1f bytes/frame", frameScheduler.GetBytesPerSecond(),
+            encodingNames[(int)frameScheduler.GetEncoding()], frameScheduler.GetBytesPerFrame());
+
+        // measured on the frames of the running effect (the script or a built-in effect)
+
+        const std::string& ledSource = GetLedEffect().type == LedEffectType::SCRIPT ? g_ledScriptPath : Config::GetLedEffectTypeName(GetLedEffect().type);
+
+        ImGui::Text("Led frames (%s): %.1f fps written, %.1f fps acknowledged", ledSource.c_str(), device->GetWrittenFps(), device->GetAcknowledgedFps());
+
+        // write calls & usb packets used per frame (gather writes vs contiguous copies)
+
+        bool gatherWrites = device->GetGatherWrites();
+
+        if (ImGui::Checkbox("Gather writes", &gatherWrites))
+        {
+            device->SetGatherWrites(gatherWrites);
+            device->ResetWriteStats();
+        }
+
+        uint64_t writesCompleted = device->GetWritesCompleted();
+        uint64_t usbPackets = device->GetUsbPackets();
+
+        ImGui::Text("Writes: %.2f calls/frame, %.2f usb packets/frame, %.1f%% usb packet efficiency",
+            writesCompleted ? (double)device->GetWriteCalls() / writesCompleted : 0.0, writesCompleted ? (double)usbPackets / writesCompleted : 0.0,
+            usbPackets ? 100.0 * device->GetBytesWritten() / (usbPackets * MacroPadDevice::s_usbPacketSize) : 0.0);
+
+        // repeat coalescing
+
+        int coalesceWindowMs = device->GetCoalesceWindowMs();
+
+        if (ImGui::SliderInt("Coalesce window (ms)", &coalesceWindowMs, 0, 100))
+        {
+            device->SetCoalesceWindowMs(coalesceWindowMs);
+        }
+
+        ImGui::Text("Commands: %llu received, %llu actions dispatched", (unsigned long long)device->GetCommandsReceived(), (unsigned long long)device->GetActionsDispatched());
+
+        // input latency (us)
+
+        const MacroPadDevice::LatencyStats& latencyStats = device->GetLatencyStats();
+        const std::pair<const char*, const LatencyHistogram*> latencyStages[] = { { "Receive", &latencyStats.receive }, { "Parse", &latencyStats.parse }, { "Dispatch", &latencyStats.dispatch } };
+
+        for (const auto& [stageName, histogram] : latencyStages)
+        {
+            ImGui::Text("%s: p50 %llu us, p90 %llu us, p99 %llu us, max %llu us (%llu events)", stageName,
+                (unsigned long long)histogram->GetPercentile(50.0), (unsigned long long)histogram->GetPercentile(90.0),
+                (unsigned long long)histogram->GetPercentile(99.0), (unsigned long long)histogram->GetMax(), (unsigned long long)histogram->GetCount());
+        }
+
+        if (!device->HasClockOffset())
+            ImGui::TextUnformatted("Receive: waiting for the clock offset");
+
+        if (ImGui::Button("Reset latency"))
+            device->ResetLatencyStats();
+
+        ImGui::PopID();
+    }
+
+    // action executor (queue & execution time of every lane)
+
+    const ActionExecutor& actionExecutor = m_deviceManager.GetActionExecutor();
+    const std::pair<const char*, const ActionExecutor::LaneStats*> executorLanes[] = { { "Key macros", &actionExecutor.GetKeyMacroStats() }, { "Processes", &actionExecutor.GetProcessStats() } };
+
+    ImGui::Separator();
+
+    for (const auto& [laneName, laneStats] : executorLanes)
     {
-        m_ledsData[i].r = ledDataNormalized[i * 3 + 0] * 255;
-        m_ledsData[i].g = ledDataNormalized[i * 3 + 1] * 255;
-        m_ledsData[i].b = ledDataNormalized[i * 3 + 2] * 255;
+        ImGui::Text("%s: queue p50 %llu us, p99 %llu us, execution p50 %llu us, p99 %llu us (%llu actions)", laneName,
+            (unsigned long long)laneStats->queue.GetPercentile(50.0), (unsigned long long)laneStats->queue.GetPercentile(99.0),
+            (unsigned long long)laneStats->execution.GetPercentile(50.0), (unsigned long long)laneStats->execution.GetPercentile(99.0), (unsigned long long)laneStats->execution.GetCount());
     }
 
+    // timed macros (how late the scheduler hands the batches)
+
+    const MacroScheduler& macroScheduler = actionExecutor.GetMacroScheduler();
+    const LatencyHistogram& jitter = macroScheduler.GetJitter();
+
+    ImGui::Text("Timed macros: %zu running, jitter p50 %llu us, p99 %llu us, max %llu us (%llu batches)", macroScheduler.GetRunningMacros(),
+        (unsigned long long)jitter.GetPercentile(50.0), (unsigned long long)jitter.GetPercentile(99.0), (unsigned long long)jitter.GetMax(), (unsigned long long)jitter.GetCount());
+
+    // lua callbacks (queue time & execution time of every handler)
+
+    const ScriptWorker& scriptWorker = actionExecutor.GetScriptWorker();
+
+    ImGui::Text("Lua callbacks: queue p50 %llu us, p99 %llu us, %llu dropped", (unsigned long long)scriptWorker.GetQueueStats().GetPercentile(50.0),
+        (unsigned long long)scriptWorker.GetQueueStats().GetPercentile(99.0), (unsigned long long)scriptWorker.GetDroppedCallbacks());
+
+    scriptWorker.ForEachCallbackStats([](const std::string& function, const LatencyHistogram& execution) {
+        ImGui::Text("  %s: p50 %llu us, p99 %llu us, max %llu us (%llu calls)", function.c_str(), (unsigned long long)execution.GetPercentile(50.0),
+            (unsigned long long)execution.GetPercentile(99.0), (unsigned long long)execution.GetMax(), (unsigned long long)execution.GetCount());
+    });
+
+    if (ImGui::Button("Dump latency"))
+        DumpLatencyStats("latency.json");
 
     ImGui::End();
 
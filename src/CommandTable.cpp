@@ -0,0 +1,119 @@
+#include "CommandTable.h"
+#include <algorithm>
+#include <iostream>
+
+static bool SameAction(const Action& a, const Action& b)
+{
+	return a.type == b.type && a.keys == b.keys && a.processPath == b.processPath && a.steps == b.steps && a.profileName == b.profileName && a.luaFunction == b.luaFunction;
+}
+
+/* COMMAND TABLE */
+
+CommandTable::CommandTable()
+{
+	m_slots.assign(1, Slot{ 0, s_invalidId });
+	m_nameOffsets.assign(1, 0);
+}
+
+CommandTable::CommandTable(const CommandsMap& commandsMap, const InputInjector* inputInjector, const ProcessLauncher* processLauncher)
+	: CommandTable()
+{
+	// ids follow the name order so they don't depend on the order of the map
+
+	std::vector<const CommandsMap::value_type*> commands;
+	commands.reserve(commandsMap.size());
+
+	for (const auto& command : commandsMap)
+		commands.push_back(&command);
+
+	std::sort(commands.begin(), commands.end(), [](const auto* a, const auto* b) { return a->first < b->first; });
+
+	if (commands.size() > s_maxCommands)
+	{
+		std::cerr << "[WARNING] Only the first " << s_maxCommands << " of " << commands.size() << " commands are used" << std::endl;
+		commands.resize(s_maxCommands);
+	}
+
+	// names & shared actions
+
+	m_nameOffsets.reserve(commands.size() + 1);
+	m_actionIndices.reserve(commands.size());
+
+	for (const auto* command : commands)
+	{
+		m_names += command->first;
+		m_nameOffsets.push_back((uint32_t)m_names.size());
+
+		auto it = std::find_if(m_actions.begin(), m_actions.end(), [&](const Action& action) { return SameAction(action, command->second); });
+
+		if (it == m_actions.end())
+			it = m_actions.insert(it, command->second);
+
+		m_actionIndices.push_back((uint16_t)(it - m_actions.begin()));
+	}
+
+	// input sequences of the key macros, prepared processes & timed macros
+
+	m_inputSequences.resize(m_actions.size());
+	m_preparedProcesses.resize(m_actions.size());
+	m_timedMacros.resize(m_actions.size());
+
+	for (size_t i = 0; i < m_actions.size(); i++)
+	{
+		if (m_actions[i].type == KEY_MACRO && inputInjector)
+			m_inputSequences[i] = inputInjector->Compile(InputInjector::BuildKeyMacroEvents(m_actions[i].keys));
+		else if (m_actions[i].type == OPEN_PROCESS && processLauncher)
+			m_preparedProcesses[i] = processLauncher->Prepare(m_actions[i].processPath);
+		else if (m_actions[i].type == TIMED_MACRO && inputInjector)
+			m_timedMacros[i] = std::make_unique<TimedMacro>(m_actions[i].steps, *inputInjector);
+	}
+
+	// hash table
+
+	size_t numSlots = 1;
+
+	while (numSlots < commands.size() * 2)
+		numSlots *= 2;
+
+	m_slots.assign(numSlots, Slot{ 0, s_invalidId });
+
+	for (uint16_t id = 0; id < commands.size(); id++)
+	{
+		uint32_t hash = Hash(GetName(id));
+		size_t slot = hash & (numSlots - 1);
+
+		while (m_slots[slot].id != s_invalidId)
+			slot = (slot + 1) & (numSlots - 1);
+
+		m_slots[slot] = Slot{ hash, id };
+	}
+}
+
+uint16_t CommandTable::Find(std::string_view name) const
+{
+	uint32_t hash = Hash(name);
+	size_t mask = m_slots.size() - 1;
+
+	for (size_t slot = hash & mask; m_slots[slot].id != s_invalidId; slot = (slot + 1) & mask)
+	{
+		if (m_slots[slot].hash == hash && GetName(m_slots[slot].id) == name)
+			return m_slots[slot].id;
+	}
+
+	return s_invalidId;
+}
+
+uint32_t CommandTable::Hash(std::string_view name)
+{
+	// fnv-1a
+
+	uint32_t hash = 2166136261u;
+
+	for (char c : name)
+	{
+		hash ^= (uint8_t)c;
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
@@ -0,0 +1,444 @@
+#include "Config.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <nlohmann/json.hpp>
+
+using namespace nlohmann; // for using json instead of nlohmann::json
+
+static const std::string g_actionTypeStr = "action_type";
+static const std::string g_keysStr = "keys";
+static const std::string g_processPathStr = "process_path";
+static const std::string g_stepsStr = "steps";
+static const std::string g_stepStr = "step";
+static const std::string g_keyStr = "key";
+static const std::string g_millisecondsStr = "ms";
+static const std::string g_countStr = "count";
+static const std::string g_textStr = "text";
+static const std::string g_profileStr = "profile";
+static const std::string g_profilesStr = "profiles";
+static const std::string g_activeProfileStr = "active_profile";
+static const std::string g_commandsStr = "commands";
+static const std::string g_applicationsStr = "applications";
+static const std::string g_functionStr = "function";
+static const std::string g_ledEffectStr = "led_effect";
+static const std::string g_typeStr = "type";
+static const std::string g_speedStr = "speed";
+static const std::string g_frequencyStr = "frequency";
+static const std::string g_colorStr = "color";
+static const std::string g_color2Str = "color2";
+static const std::string g_shaderStr = "shader";
+static const std::string g_ledGeometryStr = "led_geometry";
+static const std::string g_widthStr = "width";
+static const std::string g_heightStr = "height";
+static const std::string g_xStr = "x";
+static const std::string g_yStr = "y";
+static const std::string g_wiringStr = "wiring";
+static const std::string g_panelsStr = "panels";
+static const std::string g_groupsStr = "groups";
+
+static std::unordered_map<ActionType, std::string> g_actionTypeToStringMap = {
+	{ ActionType::NONE        , "none"         },
+	{ ActionType::KEY_MACRO   , "key_macro"    },
+	{ ActionType::OPEN_PROCESS, "open_process" },
+	{ ActionType::TIMED_MACRO , "timed_macro"  },
+	{ ActionType::SWITCH_PROFILE, "switch_profile" },
+	{ ActionType::LUA_CALLBACK, "lua_callback" }
+};
+
+static std::unordered_map<std::string, ActionType> g_stringToActionTypeMap = {
+	{ "none"     ,    ActionType::NONE         },
+	{ "key_macro",    ActionType::KEY_MACRO    },
+	{ "open_process", ActionType::OPEN_PROCESS },
+	{ "timed_macro",  ActionType::TIMED_MACRO  },
+	{ "switch_profile", ActionType::SWITCH_PROFILE },
+	{ "lua_callback", ActionType::LUA_CALLBACK }
+};
+
+static std::unordered_map<MacroStepType, std::string> g_macroStepTypeToStringMap = {
+	{ MacroStepType::PRESS  , "press"   },
+	{ MacroStepType::RELEASE, "release" },
+	{ MacroStepType::TAP    , "tap"     },
+	{ MacroStepType::HOLD   , "hold"    },
+	{ MacroStepType::DELAY  , "delay"   },
+	{ MacroStepType::TEXT   , "text"    },
+	{ MacroStepType::REPEAT , "repeat"  }
+};
+
+static std::unordered_map<std::string, MacroStepType> g_stringToMacroStepTypeMap = {
+	{ "press"  , MacroStepType::PRESS   },
+	{ "release", MacroStepType::RELEASE },
+	{ "tap"    , MacroStepType::TAP     },
+	{ "hold"   , MacroStepType::HOLD    },
+	{ "delay"  , MacroStepType::DELAY   },
+	{ "text"   , MacroStepType::TEXT    },
+	{ "repeat" , MacroStepType::REPEAT  }
+};
+
+static std::unordered_map<LedEffectType, std::string> g_ledEffectTypeToStringMap = {
+	{ LedEffectType::SCRIPT     , "script"      },
+	{ LedEffectType::SOLID      , "solid"       },
+	{ LedEffectType::GRADIENT   , "gradient"    },
+	{ LedEffectType::BREATHING  , "breathing"   },
+	{ LedEffectType::COLOR_WHEEL, "color_wheel" },
+	{ LedEffectType::RADIAL_SINE, "radial_sine" },
+	{ LedEffectType::SHADER     , "shader"      }
+};
+
+static std::unordered_map<std::string, LedEffectType> g_stringToLedEffectTypeMap = {
+	{ "script"     , LedEffectType::SCRIPT      },
+	{ "solid"      , LedEffectType::SOLID       },
+	{ "gradient"   , LedEffectType::GRADIENT    },
+	{ "breathing"  , LedEffectType::BREATHING   },
+	{ "color_wheel", LedEffectType::COLOR_WHEEL },
+	{ "radial_sine", LedEffectType::RADIAL_SINE },
+	{ "shader"     , LedEffectType::SHADER      }
+};
+
+static std::unordered_map<LedWiring, std::string> g_ledWiringToStringMap = {
+	{ LedWiring::ROW_MAJOR , "row_major"  },
+	{ LedWiring::SERPENTINE, "serpentine" }
+};
+
+static std::unordered_map<std::string, LedWiring> g_stringToLedWiringMap = {
+	{ "row_major" , LedWiring::ROW_MAJOR  },
+	{ "serpentine", LedWiring::SERPENTINE }
+};
+
+// steps of a timed macro, every step only has the fields its type uses
+
+static json SerializeMacroSteps(const std::vector<MacroStep>& steps)
+{
+	json jsonSteps = json::array();
+
+	for (const MacroStep& step : steps)
+	{
+		json jsonStep;
+		jsonStep[g_stepStr] = g_macroStepTypeToStringMap[step.type];
+
+		switch (step.type)
+		{
+		case MacroStepType::PRESS:
+		case MacroStepType::RELEASE:
+		case MacroStepType::TAP:
+			jsonStep[g_keyStr] = step.key;
+			break;
+		case MacroStepType::HOLD:
+			jsonStep[g_keyStr] = step.key;
+			jsonStep[g_millisecondsStr] = step.milliseconds;
+			break;
+		case MacroStepType::DELAY:
+			jsonStep[g_millisecondsStr] = step.milliseconds;
+			break;
+		case MacroStepType::TEXT:
+			jsonStep[g_textStr] = step.text;
+			jsonStep[g_millisecondsStr] = step.milliseconds;
+			break;
+		case MacroStepType::REPEAT:
+			jsonStep[g_countStr] = step.count;
+			jsonStep[g_stepsStr] = SerializeMacroSteps(step.steps);
+			break;
+		}
+
+		jsonSteps.push_back(jsonStep);
+	}
+
+	return jsonSteps;
+}
+
+static std::vector<MacroStep> DeserializeMacroSteps(const json& jsonSteps)
+{
+	std::vector<MacroStep> steps;
+
+	for (const json& jsonStep : jsonSteps)
+	{
+		auto it = g_stringToMacroStepTypeMap.find(jsonStep.value(g_stepStr, ""));
+
+		if (it == g_stringToMacroStepTypeMap.end())
+		{
+			std::cerr << "[WARNING] Unknown macro step " << jsonStep.dump() << std::endl;
+			continue;
+		}
+
+		MacroStep step;
+		step.type = it->second;
+		step.key = jsonStep.value(g_keyStr, (unsigned char)0);
+		step.milliseconds = jsonStep.value(g_millisecondsStr, 0u);
+		step.count = jsonStep.value(g_countStr, 0u);
+		step.text = jsonStep.value(g_textStr, "");
+
+		if (step.type == MacroStepType::REPEAT && jsonStep.contains(g_stepsStr))
+			step.steps = DeserializeMacroSteps(jsonStep[g_stepsStr]);
+
+		steps.push_back(std::move(step));
+	}
+
+	return steps;
+}
+
+// led effect, the missing fields keep their defaults
+
+static json SerializeLedEffect(const LedEffect& effect)
+{
+	json jsonEffect;
+
+	jsonEffect[g_typeStr] = g_ledEffectTypeToStringMap[effect.type];
+	jsonEffect[g_speedStr] = effect.speed;
+	jsonEffect[g_frequencyStr] = effect.frequency;
+	jsonEffect[g_colorStr] = effect.color;
+	jsonEffect[g_color2Str] = effect.color2;
+
+	if (effect.type == LedEffectType::SHADER)
+		jsonEffect[g_shaderStr] = effect.shaderPath;
+
+	return jsonEffect;
+}
+
+static LedEffect DeserializeLedEffect(const json& jsonEffect)
+{
+	LedEffect effect;
+	auto it = g_stringToLedEffectTypeMap.find(jsonEffect.value(g_typeStr, ""));
+
+	if (it == g_stringToLedEffectTypeMap.end())
+	{
+		std::cerr << "[WARNING] Unknown led effect " << jsonEffect.dump() << std::endl;
+		return effect;
+	}
+
+	effect.type = it->second;
+	effect.speed = jsonEffect.value(g_speedStr, effect.speed);
+	effect.frequency = jsonEffect.value(g_frequencyStr, effect.frequency);
+	effect.color = jsonEffect.value(g_colorStr, effect.color);
+	effect.color2 = jsonEffect.value(g_color2Str, effect.color2);
+	effect.shaderPath = jsonEffect.value(g_shaderStr, "");
+
+	return effect;
+}
+
+// led matrix, panels (in wiring order) & per key groups
+
+static json SerializeLedGeometry(const LedGeometry& geometry)
+{
+	json jsonGeometry;
+
+	jsonGeometry[g_widthStr] = geometry.GetWidth();
+	jsonGeometry[g_heightStr] = geometry.GetHeight();
+	jsonGeometry[g_panelsStr] = json::array();
+	jsonGeometry[g_groupsStr] = json::object();
+
+	for (const LedPanel& panel : geometry.GetPanels())
+	{
+		jsonGeometry[g_panelsStr].push_back({
+			{ g_xStr, panel.x },
+			{ g_yStr, panel.y },
+			{ g_widthStr, panel.width },
+			{ g_heightStr, panel.height },
+			{ g_wiringStr, g_ledWiringToStringMap[panel.wiring] }
+		});
+	}
+
+	for (const LedGroup& group : geometry.GetGroups())
+	{
+		jsonGeometry[g_groupsStr][group.name] = {
+			{ g_xStr, group.x },
+			{ g_yStr, group.y },
+			{ g_widthStr, group.width },
+			{ g_heightStr, group.height }
+		};
+	}
+
+	return jsonGeometry;
+}
+
+static LedGeometry DeserializeLedGeometry(const json& jsonGeometry)
+{
+	std::vector<LedPanel> panels;
+	std::vector<LedGroup> groups;
+
+	for (const json& jsonPanel : jsonGeometry.value(g_panelsStr, json::array()))
+	{
+		LedPanel panel;
+		panel.x = jsonPanel.value(g_xStr, 0);
+		panel.y = jsonPanel.value(g_yStr, 0);
+		panel.width = jsonPanel.value(g_widthStr, 0);
+		panel.height = jsonPanel.value(g_heightStr, 0);
+
+		auto it = g_stringToLedWiringMap.find(jsonPanel.value(g_wiringStr, "row_major"));
+
+		if (it != g_stringToLedWiringMap.end())
+			panel.wiring = it->second;
+		else
+			std::cerr << "[WARNING] Unknown led wiring " << jsonPanel.dump() << std::endl;
+
+		panels.push_back(panel);
+	}
+
+	const json jsonGroups = jsonGeometry.value(g_groupsStr, json::object());
+
+	for (const auto& element : jsonGroups.items())
+	{
+		LedGroup group;
+		group.name = element.key();
+		group.x = element.value().value(g_xStr, 0);
+		group.y = element.value().value(g_yStr, 0);
+		group.width = element.value().value(g_widthStr, 0);
+		group.height = element.value().value(g_heightStr, 0);
+
+		groups.push_back(std::move(group));
+	}
+
+	return LedGeometry(jsonGeometry.value(g_widthStr, LedGeometry::s_defaultWidth), jsonGeometry.value(g_heightStr, LedGeometry::s_defaultHeight),
+		std::move(panels), std::move(groups));
+}
+
+static void SerializeAction(const std::string& commandName, const Action& action, json& jsonConfigFile)
+{
+	jsonConfigFile[commandName][g_actionTypeStr] = g_actionTypeToStringMap[action.type];
+
+	switch (action.type)
+	{
+	case KEY_MACRO:
+		jsonConfigFile[commandName][g_keysStr] = action.keys;
+		break;
+	case OPEN_PROCESS:
+		jsonConfigFile[commandName][g_processPathStr] = action.processPath;
+		break;
+	case TIMED_MACRO:
+		jsonConfigFile[commandName][g_stepsStr] = SerializeMacroSteps(action.steps);
+		break;
+	case SWITCH_PROFILE:
+		jsonConfigFile[commandName][g_profileStr] = action.profileName;
+		break;
+	case LUA_CALLBACK:
+		jsonConfigFile[commandName][g_functionStr] = action.luaFunction;
+		break;
+	case NONE:
+		break;
+	}
+}
+
+static Action DeserializeAction(const std::string& commandName, const json& jsonConfigFile)
+{
+	Action action;
+	action.type = g_stringToActionTypeMap[jsonConfigFile[commandName][g_actionTypeStr]];
+
+	switch (action.type)
+	{
+	case KEY_MACRO:
+		action.keys = jsonConfigFile[commandName][g_keysStr].get<std::vector<unsigned char>>();
+		break;
+	case OPEN_PROCESS:
+		action.processPath = jsonConfigFile[commandName][g_processPathStr];
+		break;
+	case TIMED_MACRO:
+		action.steps = DeserializeMacroSteps(jsonConfigFile[commandName][g_stepsStr]);
+		break;
+	case SWITCH_PROFILE:
+		action.profileName = jsonConfigFile[commandName][g_profileStr];
+		break;
+	case LUA_CALLBACK:
+		action.luaFunction = jsonConfigFile[commandName][g_functionStr];
+		break;
+	case NONE:
+		break;
+	}
+
+	return action;
+}
+
+/* CONFIG */
+
+std::string Config::Serialize() const
+{
+	json configFile;
+
+	for (const auto& [profileName, profile] : profiles)
+	{
+		json& jsonProfile = configFile[g_profilesStr][profileName];
+		jsonProfile[g_applicationsStr] = profile.applications;
+		jsonProfile[g_commandsStr] = json::object();
+
+		for (const auto& [commandName, action] : profile.commandsMap)
+		{
+			SerializeAction(commandName, action, jsonProfile[g_commandsStr]);
+		}
+	}
+
+	if (!activeProfile.empty())
+		configFile[g_activeProfileStr] = activeProfile;
+
+	if (ledEffect)
+		configFile[g_ledEffectStr] = SerializeLedEffect(*ledEffect);
+
+	if (ledGeometry)
+		configFile[g_ledGeometryStr] = SerializeLedGeometry(*ledGeometry);
+
+	return configFile.dump(4);
+}
+
+Config Config::Deserialize(std::string_view text)
+{
+	json configFile = json::parse(text);
+	Config config;
+
+	// the configs without profiles are the commands of the default profile
+
+	if (!configFile.contains(g_profilesStr))
+		configFile = { { g_profilesStr, { { s_defaultProfile, { { g_commandsStr, configFile } } } } } };
+
+	for (auto& jsonProfile : configFile[g_profilesStr].items())
+	{
+		Profile& profile = config.profiles[jsonProfile.key()];
+		const json& jsonCommands = jsonProfile.value()[g_commandsStr];
+
+		for (auto& element : jsonCommands.items())
+		{
+			const std::string& commandName = element.key();
+			profile.commandsMap[commandName] = DeserializeAction(commandName, jsonCommands);
+		}
+
+		profile.applications = jsonProfile.value().value(g_applicationsStr, std::vector<std::string>());
+	}
+
+	if (configFile.contains(g_activeProfileStr))
+		config.activeProfile = configFile[g_activeProfileStr].get<std::string>();
+
+	if (configFile.contains(g_ledEffectStr))
+		config.ledEffect = DeserializeLedEffect(configFile[g_ledEffectStr]);
+
+	if (configFile.contains(g_ledGeometryStr))
+		config.ledGeometry = DeserializeLedGeometry(configFile[g_ledGeometryStr]);
+
+	return config;
+}
+
+void Config::Save(const std::string& path) const
+{
+	std::ofstream file(path);
+	file << Serialize();
+}
+
+Config Config::Load(const std::string& path)
+{
+	std::ifstream file(path);
+	std::stringstream text;
+	text << file.rdbuf();
+
+	return Deserialize(text.str());
+}
+
+const std::string& Config::GetLedEffectTypeName(LedEffectType type)
+{
+	return g_ledEffectTypeToStringMap[type];
+}
+
+bool Config::FindLedEffectType(std::string_view name, LedEffectType& type)
+{
+	auto it = g_stringToLedEffectTypeMap.find(std::string(name));
+
+	if (it == g_stringToLedEffectTypeMap.end())
+		return false;
+
+	type = it->second;
+	return true;
+}
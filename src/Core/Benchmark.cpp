@@ -0,0 +1,46 @@
+#include "Core/Benchmark.h"
+#include <algorithm>
+#include <chrono>
+
+static volatile uint64_t g_sink;
+
+void Benchmark::Run(const std::string& name, const Body& body)
+{
+	// double the iterations until a run is long enough to be timed, then scale to the sample time
+
+	uint64_t iterations = 1;
+	uint64_t elapsed = Time(body, iterations);
+
+	while (elapsed < s_sampleTimeNs / 10 && iterations < (1ull << 40))
+	{
+		iterations *= 2;
+		elapsed = Time(body, iterations);
+	}
+
+	iterations = std::max<uint64_t>(1, (uint64_t)((double)iterations * s_sampleTimeNs / std::max<uint64_t>(elapsed, 1)));
+
+	// samples
+
+	std::vector<double> samples;
+
+	for (int i = 0; i < s_numSamples; i++)
+		samples.push_back((double)Time(body, iterations) / iterations);
+
+	std::sort(samples.begin(), samples.end());
+
+	m_results.push_back(Result{ name, iterations, samples[samples.size() / 2], samples.front(), samples.back() });
+}
+
+void Benchmark::Consume(uint64_t value)
+{
+	g_sink = value;
+}
+
+uint64_t Benchmark::Time(const Body& body, uint64_t iterations)
+{
+	auto begin = std::chrono::steady_clock::now();
+
+	body(iterations);
+
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - begin).count();
+}
@@ -257,4 +257,68 @@ void ShaderStorageBuffer::GetData(void* data)
 void ShaderStorageBuffer::Bind(uint32_t binding) const
 {
 	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding, m_id);
-}
\ No newline at end of file
+}
+
+/* MAPPED SHADER STORAGE BUFFER */
+
+MappedShaderStorageBuffer::MappedShaderStorageBuffer(size_t regionSize, uint32_t numRegions)
+{
+	GLint alignment = 1;
+	glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &alignment);
+
+	m_regionSize = regionSize;
+	m_regionStride = (regionSize + alignment - 1) / alignment * alignment;
+	m_fences.resize(numRegions, nullptr);
+
+	// coherent, so the writes of the gpu are visible once the fence has passed (the shader has to be followed by a
+	// GL_CLIENT_MAPPED_BUFFER_BARRIER_BIT barrier)
+
+	GLbitfield flags = GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+	glGenBuffers(1, &m_id);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_id);
+	glBufferStorage(GL_SHADER_STORAGE_BUFFER, m_regionStride * numRegions, nullptr, flags);
+	m_data = (const uint8_t*)glMapBufferRange(GL_SHADER_STORAGE_BUFFER, 0, m_regionStride * numRegions, flags);
+}
+
+MappedShaderStorageBuffer::~MappedShaderStorageBuffer()
+{
+	for (void* fence : m_fences)
+	{
+		if (fence)
+			glDeleteSync((GLsync)fence);
+	}
+
+	if (m_data)
+	{
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_id);
+		glUnmapBuffer(GL_SHADER_STORAGE_BUFFER);
+	}
+
+	glDeleteBuffers(1, &m_id);
+}
+
+void MappedShaderStorageBuffer::BindRegion(uint32_t region, uint32_t binding) const
+{
+	glBindBufferRange(GL_SHADER_STORAGE_BUFFER, binding, m_id, region * m_regionStride, m_regionSize);
+}
+
+void MappedShaderStorageBuffer::Fence(uint32_t region)
+{
+	if (m_fences[region])
+		glDeleteSync((GLsync)m_fences[region]);
+
+	m_fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+bool MappedShaderStorageBuffer::IsReady(uint32_t region) const
+{
+	if (!m_fences[region])
+		return false;
+
+	// timeout 0 only polls, the flush makes sure the fence gets to the gpu
+
+	GLenum result = glClientWaitSync((GLsync)m_fences[region], GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+
+	return result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED;
+}
@@ -0,0 +1,99 @@
+#include "Core/LatencyHistogram.h"
+#include <bit>
+
+LatencyHistogram::LatencyHistogram()
+{
+	Reset();
+}
+
+double LatencyHistogram::GetMean() const
+{
+	uint64_t count = GetCount();
+
+	return count > 0 ? (double)m_sum.load(std::memory_order_relaxed) / count : 0.0;
+}
+
+uint64_t LatencyHistogram::GetPercentile(double percentile) const
+{
+	uint64_t count = GetCount();
+
+	if (count == 0)
+		return 0;
+
+	// rank of the percentile, then walk the buckets until it is reached
+
+	uint64_t rank = (uint64_t)(percentile / 100.0 * count + 0.5);
+
+	if (rank == 0)
+		rank = 1;
+
+	uint64_t accumulated = 0;
+
+	for (size_t i = 0; i < s_numBuckets; i++)
+	{
+		accumulated += GetBucketCount(i);
+
+		if (accumulated >= rank)
+			return GetBucketUpperBound(i) < GetMax() ? GetBucketUpperBound(i) : GetMax();
+	}
+
+	return GetMax();
+}
+
+uint64_t LatencyHistogram::GetBucketLowerBound(size_t bucket)
+{
+	if (bucket < 16)
+		return bucket;
+
+	size_t power = (bucket - 16) / 8 + 4;
+	size_t subBucket = (bucket - 16) % 8;
+
+	return (uint64_t)(8 + subBucket) << (power - 3);
+}
+
+uint64_t LatencyHistogram::GetBucketUpperBound(size_t bucket)
+{
+	if (bucket < 16)
+		return bucket;
+
+	size_t power = (bucket - 16) / 8 + 4;
+
+	return GetBucketLowerBound(bucket) + ((uint64_t)1 << (power - 3)) - 1;
+}
+
+void LatencyHistogram::Record(uint64_t microseconds)
+{
+	m_buckets[GetBucket(microseconds)].fetch_add(1, std::memory_order_relaxed);
+	m_count.fetch_add(1, std::memory_order_relaxed);
+	m_sum.fetch_add(microseconds, std::memory_order_relaxed);
+
+	uint64_t max = m_max.load(std::memory_order_relaxed);
+
+	while (microseconds > max && !m_max.compare_exchange_weak(max, microseconds, std::memory_order_relaxed))
+	{
+	}
+}
+
+void LatencyHistogram::Reset()
+{
+	for (auto& bucket : m_buckets)
+		bucket.store(0, std::memory_order_relaxed);
+
+	m_count.store(0, std::memory_order_relaxed);
+	m_sum.store(0, std::memory_order_relaxed);
+	m_max.store(0, std::memory_order_relaxed);
+}
+
+size_t LatencyHistogram::GetBucket(uint64_t microseconds)
+{
+	if (microseconds < 16)
+		return (size_t)microseconds;
+
+	// power of two & the 3 bits below it
+
+	size_t power = std::bit_width(microseconds) - 1;
+	size_t subBucket = (microseconds >> (power - 3)) & 7;
+	size_t bucket = 16 + (power - 4) * 8 + subBucket;
+
+	return bucket < s_numBuckets ? bucket : s_numBuckets - 1;
+}
@@ -0,0 +1,83 @@
+#include "Core/TimerWheel.h"
+#include <bit>
+
+TimerWheel::TimerWheel(uint64_t startTick)
+{
+	m_currentTick = startTick;
+	m_size = 0;
+
+	for (int level = 0; level < s_levels; level++)
+		m_occupied[level] = 0;
+}
+
+void TimerWheel::Schedule(uint64_t tick, uint32_t payload)
+{
+	if (tick <= m_currentTick)
+		tick = m_currentTick + 1;
+
+	Insert(Timer{ tick, payload });
+	m_size++;
+}
+
+uint64_t TimerWheel::GetNextExpiry() const
+{
+	if (m_size == 0)
+		return s_noExpiry;
+
+	// first timer of level 0 after the current slot
+
+	uint64_t pending = m_occupied[0] & (~1ull << (m_currentTick & s_slotMask));
+
+	if (pending != 0)
+		return (m_currentTick & ~s_slotMask) + std::countr_zero(pending);
+
+	return (m_currentTick | s_slotMask) + 1;
+}
+
+void TimerWheel::Insert(const Timer& timer)
+{
+	// the lowest level where the timer is in the current rotation, so its slot is always ahead of the current one
+
+	int level = 0;
+
+	while (level < s_levels - 1 && (timer.tick >> ((level + 1) * s_slotBits)) != (m_currentTick >> ((level + 1) * s_slotBits)))
+		level++;
+
+	size_t slot = (timer.tick >> (level * s_slotBits)) & s_slotMask;
+
+	m_slots[level][slot].push_back(timer);
+	m_occupied[level] |= 1ull << slot;
+}
+
+void TimerWheel::Cascade()
+{
+	// the levels that wrapped, from the highest so their timers can go down more than one level
+
+	int wrapped = 1;
+
+	while (wrapped < s_levels - 1 && ((m_currentTick >> (wrapped * s_slotBits)) & s_slotMask) == 0)
+		wrapped++;
+
+	for (int level = wrapped; level >= 1; level--)
+	{
+		size_t slot = (m_currentTick >> (level * s_slotBits)) & s_slotMask;
+
+		if (m_slots[level][slot].empty())
+			continue;
+
+		std::vector<Timer> timers;
+		timers.swap(m_slots[level][slot]);
+		m_occupied[level] &= ~(1ull << slot);
+
+		for (const Timer& timer : timers)
+			Insert(timer);
+
+		// keep the capacity for the next rotation (unless a far timer went back to the same slot)
+
+		if (m_slots[level][slot].empty())
+		{
+			timers.clear();
+			m_slots[level][slot].swap(timers);
+		}
+	}
+}
@@ -0,0 +1,56 @@
+#ifdef _WIN32
+
+#include "CreateProcessLauncher.h"
+#include <Windows.h>
+#include <iostream>
+#include <vector>
+
+/* CREATEPROCESS LAUNCHER */
+
+std::shared_ptr<const PreparedProcess> CreateProcessLauncher::Prepare(const std::string& path) const
+{
+	return std::make_shared<const PreparedProcess>(path);
+}
+
+bool CreateProcessLauncher::Launch(const PreparedProcess& process)
+{
+	const std::string& path = process.GetPath();
+
+	STARTUPINFOA si;
+	PROCESS_INFORMATION pi;
+	ZeroMemory(&si, sizeof(si));
+	ZeroMemory(&pi, sizeof(pi));
+	si.cb = sizeof(si);
+
+	// CreateProcessA may write to the command line, so every launch gets its own copy
+
+	std::vector<char> commandLine(path.begin(), path.end());
+	commandLine.push_back('\0');
+
+	// Create the process
+
+	BOOL result = CreateProcessA(NULL, commandLine.data(), NULL, NULL, FALSE, 0, NULL, NULL, &si, &pi);
+
+	// Check the result
+
+	if (result)
+	{
+		// Close process and thread handles
+		
+		CloseHandle(pi.hProcess);
+		CloseHandle(pi.hThread);
+
+		std::cout << "Process: " << path << " opened succesfully" << std::endl;
+	}
+	else
+	{
+		// Failed to create the process
+		// Handle the error accordingly
+
+		std::cout << "Process: " << path << " couldn't be opened" << std::endl;
+	}
+
+	return result;
+}
+
+#endif
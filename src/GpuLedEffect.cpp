@@ -0,0 +1,119 @@
+#include "GpuLedEffect.h"
+#include <GL/glew.h>
+#include <iostream>
+#include <algorithm>
+
+/* GPU LED EFFECT */
+
+GpuLedEffect::GpuLedEffect()
+{
+	m_width = 0;
+	m_height = 0;
+	m_dispatchedFrames = 0;
+	m_readFrames = 0;
+}
+
+bool GpuLedEffect::Load(const std::string& path, int width, int height)
+{
+	Unload();
+
+	m_path = path;
+
+	if (!IsSupported())
+	{
+		std::cerr << "[WARNING] The led shader " << path << " needs opengl 4.4 (or compute shaders & buffer storage)" << std::endl;
+		return false;
+	}
+
+	auto computeShader = std::make_unique<ComputeShader>();
+
+	if (!computeShader->Load(path))
+	{
+		std::cerr << "[WARNING] The led shader " << path << " couldn't be loaded" << std::endl;
+		return false;
+	}
+
+	// one packed color (4 bytes) per led for each frame in flight
+
+	m_width = std::max(width, 0);
+	m_height = std::max(height, 0);
+
+	auto ledsBuffer = std::make_unique<MappedShaderStorageBuffer>(std::max<size_t>((size_t)m_width * m_height, 1) * 4, s_framesInFlight);
+
+	if (!ledsBuffer->IsMapped())
+	{
+		std::cerr << "[WARNING] The leds buffer of " << path << " couldn't be mapped" << std::endl;
+		return false;
+	}
+
+	m_computeShader = std::move(computeShader);
+	m_ledsBuffer = std::move(ledsBuffer);
+	m_dispatchedFrames = 0;
+	m_readFrames = 0;
+
+	return true;
+}
+
+void GpuLedEffect::Unload()
+{
+	m_computeShader.reset();
+	m_ledsBuffer.reset();
+	m_path.clear();
+}
+
+bool GpuLedEffect::Render(float time, uint8_t* rgb)
+{
+	if (!IsLoaded())
+		return false;
+
+	// the frames finish in order, the newest finished one is copied (the older ones are skipped)
+
+	uint64_t readFrames = m_readFrames;
+
+	while (readFrames < m_dispatchedFrames && m_ledsBuffer->IsReady(readFrames % s_framesInFlight))
+		readFrames++;
+
+	bool read = readFrames != m_readFrames;
+
+	if (read)
+	{
+		const uint8_t* leds = (const uint8_t*)m_ledsBuffer->GetRegionData((readFrames - 1) % s_framesInFlight);
+		size_t numLeds = (size_t)m_width * m_height;
+
+		for (size_t i = 0; i < numLeds; i++)
+		{
+			rgb[i * 3 + 0] = leds[i * 4 + 0];
+			rgb[i * 3 + 1] = leds[i * 4 + 1];
+			rgb[i * 3 + 2] = leds[i * 4 + 2];
+		}
+
+		m_readFrames = readFrames;
+	}
+
+	// a new frame only if a region is free (if the gpu is behind the frame is skipped instead of waiting)
+
+	if (m_dispatchedFrames - m_readFrames < s_framesInFlight)
+	{
+		uint32_t region = m_dispatchedFrames % s_framesInFlight;
+		uint32_t numLeds = (uint32_t)(m_width * m_height);
+
+		ComputeShader::Bind(m_computeShader.get());
+		m_computeShader->SetFloat("u_time", time);
+		m_computeShader->SetVec2("u_size", { (float)m_width, (float)m_height });
+		m_ledsBuffer->BindRegion(region, 0);
+
+		m_computeShader->Dispatch((numLeds + s_workGroupSize - 1) / s_workGroupSize, 1, 1); // followed by a barrier
+		m_ledsBuffer->Fence(region);
+
+		m_dispatchedFrames++;
+	}
+
+	return read;
+}
+
+bool GpuLedEffect::IsSupported()
+{
+	// false without a context (the flags are only set by glewInit)
+
+	return GLEW_VERSION_4_4 || (GLEW_ARB_compute_shader && GLEW_ARB_buffer_storage);
+}
@@ -0,0 +1,37 @@
+#include "InputInjector.h"
+#include "RecordingInputInjector.h"
+#include "SendInputInjector.h"
+#include "UinputInjector.h"
+#include <iostream>
+
+/* INPUT INJECTOR */
+
+std::vector<InputEvent> InputInjector::BuildKeyMacroEvents(const std::vector<unsigned char>& keys)
+{
+	std::vector<InputEvent> events;
+	events.reserve(keys.size() * 2);
+
+	for (unsigned char key : keys)
+		events.push_back(InputEvent{ key, false });
+
+	for (auto it = keys.rbegin(); it != keys.rend(); ++it)
+		events.push_back(InputEvent{ *it, true });
+
+	return events;
+}
+
+std::unique_ptr<InputInjector> CreatePlatformInputInjector()
+{
+#if defined(_WIN32)
+	return std::make_unique<SendInputInjector>();
+#elif defined(__linux__)
+	auto uinputInjector = std::make_unique<UinputInjector>();
+
+	if (uinputInjector->IsOpen())
+		return uinputInjector;
+#endif
+
+	std::cerr << "[WARNING] No input injection on this platform, the key macros are only recorded" << std::endl;
+
+	return std::make_unique<RecordingInputInjector>();
+}
@@ -0,0 +1,26 @@
+#include "LedBuffer.h"
+#include <cstring>
+#include <algorithm>
+
+static_assert(sizeof(LedColor) == 3, "the leds are read as packed rgb888");
+
+/* LED BUFFER */
+
+LedBuffer::LedBuffer(size_t numLeds)
+{
+	m_numLeds = 0;
+
+	Resize(numLeds);
+}
+
+void LedBuffer::Resize(size_t numLeds)
+{
+	// rounded up to whole cache lines (at least one, so the data is never null)
+
+	size_t size = std::max<size_t>((numLeds * 3 + s_alignment - 1) / s_alignment * s_alignment, s_alignment);
+
+	m_data.reset((uint8_t*)::operator new[](size, std::align_val_t(s_alignment)));
+	m_numLeds = numLeds;
+
+	std::memset(m_data.get(), 0, size);
+}
@@ -0,0 +1,211 @@
+#include "LedEffectEngine.h"
+#include <cmath>
+#include <algorithm>
+#include <cstring>
+
+static constexpr float s_pi = 3.14159265358979f;
+static constexpr float s_twoPi = 2.0f * s_pi;
+
+// branchless helpers (inlined in the kernels so the loops vectorize)
+
+static inline float Clamp(float x, float low, float high)
+{
+	return std::min(std::max(x, low), high);
+}
+
+// floor through an int conversion, std::floor is a library call without sse4.1 and stops the vectorizer
+
+static inline float Floor(float x)
+{
+	int32_t truncated = (int32_t)x;
+	return (float)(truncated - (int32_t)((float)truncated > x));
+}
+
+static inline float Fract(float x)
+{
+	return x - Floor(x);
+}
+
+// sine with ~0.001 error, wraps to [-pi, pi] and refines a parabola
+
+static inline float FastSin(float x)
+{
+	x -= s_twoPi * Floor(x * (1.0f / s_twoPi) + 0.5f);
+
+	float y = (4.0f / s_pi) * x - (4.0f / (s_pi * s_pi)) * x * std::fabs(x);
+
+	return 0.225f * (y * std::fabs(y) - y) + y;
+}
+
+/* LED EFFECT ENGINE */
+
+LedEffectEngine::LedEffectEngine(int width, int height)
+{
+	SetGeometry(width, height);
+}
+
+void LedEffectEngine::SetGeometry(int width, int height)
+{
+	size_t numLeds = (size_t)std::max(width, 0) * std::max(height, 0);
+
+	m_angles.resize(numLeds);
+	m_distances.resize(numLeds);
+	m_columns.resize(numLeds);
+	m_red.resize(numLeds);
+	m_green.resize(numLeds);
+	m_blue.resize(numLeds);
+
+	// same center as the scripts (floor of the half size)
+
+	float centerX = (float)(width / 2);
+	float centerY = (float)(height / 2);
+
+	for (int y = 0; y < height; y++)
+	{
+		for (int x = 0; x < width; x++)
+		{
+			size_t i = (size_t)x + (size_t)y * width;
+			float dx = x - centerX;
+			float dy = y - centerY;
+
+			m_angles[i] = std::atan2(dy, dx);
+			m_distances[i] = std::sqrt(dx * dx + dy * dy);
+			m_columns[i] = (float)x / width;
+		}
+	}
+}
+
+void LedEffectEngine::Render(float time, uint8_t* rgb)
+{
+	const std::array<uint8_t, 3>& color = m_effect.color;
+
+	switch (m_effect.type)
+	{
+	case LedEffectType::SCRIPT:
+	case LedEffectType::SHADER:
+		return;
+	case LedEffectType::SOLID:
+		Fill(rgb, color[0], color[1], color[2]);
+		return;
+	case LedEffectType::BREATHING:
+	{
+		float brightness = 0.5f - 0.5f * std::cos(time * m_effect.speed);
+		Fill(rgb, (uint8_t)(color[0] * brightness + 0.5f), (uint8_t)(color[1] * brightness + 0.5f), (uint8_t)(color[2] * brightness + 0.5f));
+		return;
+	}
+	case LedEffectType::GRADIENT:
+		RenderGradient(time);
+		break;
+	case LedEffectType::COLOR_WHEEL:
+		RenderColorWheel(time);
+		break;
+	case LedEffectType::RADIAL_SINE:
+		RenderRadialSine(time);
+		break;
+	}
+
+	Pack(rgb);
+}
+
+void LedEffectEngine::Fill(uint8_t* rgb, uint8_t red, uint8_t green, uint8_t blue) const
+{
+	// same color everywhere, the first led is written and then copied over doubling sizes
+
+	size_t size = GetNumLeds() * 3;
+
+	if (size == 0)
+		return;
+
+	rgb[0] = red;
+	rgb[1] = green;
+	rgb[2] = blue;
+
+	for (size_t filled = 3; filled < size; filled *= 2)
+		std::memcpy(rgb + filled, rgb, std::min(filled, size - filled));
+}
+
+void LedEffectEngine::RenderGradient(float time)
+{
+	// triangle wave so the scrolled gradient has no seam
+
+	const float* columns = m_columns.data();
+	float* red = m_red.data();
+	float* green = m_green.data();
+	float* blue = m_blue.data();
+	size_t numLeds = m_columns.size();
+
+	float offset = time * m_effect.speed * 0.1f;
+	float frequency = m_effect.frequency;
+	float r0 = m_effect.color[0], g0 = m_effect.color[1], b0 = m_effect.color[2];
+	float dr = m_effect.color2[0] - r0, dg = m_effect.color2[1] - g0, db = m_effect.color2[2] - b0;
+
+	for (size_t i = 0; i < numLeds; i++)
+	{
+		float t = std::fabs(2.0f * Fract(columns[i] * frequency + offset) - 1.0f);
+
+		red[i] = r0 + dr * t;
+		green[i] = g0 + dg * t;
+		blue[i] = b0 + db * t;
+	}
+}
+
+void LedEffectEngine::RenderColorWheel(float time)
+{
+	// hue of the angle (like rainbow.lua), hsv -> rgb with full saturation & value without branches
+
+	const float* angles = m_angles.data();
+	float* red = m_red.data();
+	float* green = m_green.data();
+	float* blue = m_blue.data();
+	size_t numLeds = m_angles.size();
+
+	float rotation = time * m_effect.speed;
+
+	for (size_t i = 0; i < numLeds; i++)
+	{
+		float hue = Fract((angles[i] + rotation) * (1.0f / s_twoPi)) * 6.0f;
+
+		red[i] = Clamp(255.0f * (std::fabs(hue - 3.0f) - 1.0f), 0.0f, 255.0f);
+		green[i] = Clamp(255.0f * (2.0f - std::fabs(hue - 2.0f)), 0.0f, 255.0f);
+		blue[i] = Clamp(255.0f * (2.0f - std::fabs(hue - 4.0f)), 0.0f, 255.0f);
+	}
+}
+
+void LedEffectEngine::RenderRadialSine(float time)
+{
+	// rings moving out of the center (like sine2d.lua)
+
+	const float* distances = m_distances.data();
+	float* red = m_red.data();
+	float* green = m_green.data();
+	float* blue = m_blue.data();
+	size_t numLeds = m_distances.size();
+
+	float phase = time * m_effect.speed;
+	float frequency = m_effect.frequency;
+	float r = m_effect.color[0], g = m_effect.color[1], b = m_effect.color[2];
+
+	for (size_t i = 0; i < numLeds; i++)
+	{
+		float value = std::fabs(FastSin(distances[i] * frequency + phase));
+
+		red[i] = r * value;
+		green[i] = g * value;
+		blue[i] = b * value;
+	}
+}
+
+void LedEffectEngine::Pack(uint8_t* rgb) const
+{
+	const float* red = m_red.data();
+	const float* green = m_green.data();
+	const float* blue = m_blue.data();
+	size_t numLeds = m_red.size();
+
+	for (size_t i = 0; i < numLeds; i++)
+	{
+		rgb[i * 3 + 0] = (uint8_t)(int32_t)(red[i] + 0.5f);
+		rgb[i * 3 + 1] = (uint8_t)(int32_t)(green[i] + 0.5f);
+		rgb[i * 3 + 2] = (uint8_t)(int32_t)(blue[i] + 0.5f);
+	}
+}
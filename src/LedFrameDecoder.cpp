@@ -0,0 +1,225 @@
+#include "LedFrameDecoder.h"
+#include <cstring>
+#include <algorithm>
+
+/* LED FRAME DECODER */
+
+LedFrameDecoder::LedFrameDecoder(size_t numLeds)
+	: m_leds(numLeds * 3, 0)
+{
+	m_lastSequence = 0;
+	m_hasFrame = false;
+	m_crcErrors = 0;
+	m_state = State::WaitMagic0;
+	m_headerSize = 0;
+	m_payloadSize = 0;
+	m_crcSize = 0;
+}
+
+void LedFrameDecoder::Feed(const uint8_t* data, size_t size, const FrameCallback& callback)
+{
+	for (size_t i = 0; i < size; i++)
+	{
+		uint8_t byte = data[i];
+
+		switch (m_state)
+		{
+		case State::WaitMagic0:
+			if (byte == LED_FRAME_MAGIC_0)
+				m_state = State::WaitMagic1;
+			break;
+		case State::WaitMagic1:
+			if (byte == LED_FRAME_MAGIC_1)
+			{
+				m_header[0] = LED_FRAME_MAGIC_0;
+				m_header[1] = LED_FRAME_MAGIC_1;
+				m_headerSize = 2;
+				m_state = State::ReadHeader;
+			}
+			else if (byte != LED_FRAME_MAGIC_0)
+			{
+				m_state = State::WaitMagic0;
+			}
+			break;
+		case State::ReadHeader:
+			m_header[m_headerSize++] = byte;
+
+			if (m_headerSize == LED_FRAME_HEADER_SIZE)
+			{
+				size_t length = m_header[4] | ((size_t)m_header[5] << 8);
+
+				if (m_header[2] != LED_FRAME_VERSION || length > LED_FRAME_MAX_PAYLOAD_SIZE)
+				{
+					m_crcErrors++;
+					m_state = State::WaitMagic0;
+					break;
+				}
+
+				m_payload.resize(length);
+				m_payloadSize = 0;
+				m_crcSize = 0;
+				m_state = length > 0 ? State::ReadPayload : State::ReadCrc;
+			}
+			break;
+		case State::ReadPayload:
+		{
+			// copy as much of the payload as there is in one go
+
+			size_t count = std::min(m_payload.size() - m_payloadSize, size - i);
+			std::memcpy(m_payload.data() + m_payloadSize, data + i, count);
+			m_payloadSize += count;
+			i += count - 1;
+
+			if (m_payloadSize == m_payload.size())
+				m_state = State::ReadCrc;
+		}
+		break;
+		case State::ReadCrc:
+			m_crc[m_crcSize++] = byte;
+
+			if (m_crcSize == LED_FRAME_TRAILER_SIZE)
+			{
+				uint16_t crc = LedFrameCrc16(m_header + 2, LED_FRAME_HEADER_SIZE - 2);
+				crc = LedFrameCrc16(m_payload.data(), m_payload.size(), crc);
+
+				if (crc == (m_crc[0] | (m_crc[1] << 8)))
+					callback({ (LedFrameType)m_header[3], m_header[6], m_payload.data(), m_payload.size() });
+				else
+					m_crcErrors++;
+
+				m_state = State::WaitMagic0;
+			}
+			break;
+		}
+	}
+}
+
+bool LedFrameDecoder::Apply(const Frame& frame)
+{
+	size_t numLeds = m_leds.size() / 3;
+	bool applied = false;
+
+	switch (frame.type)
+	{
+	case LedFrameType::Full:
+		if (frame.size == m_leds.size())
+		{
+			std::memcpy(m_leds.data(), frame.payload, frame.size);
+			applied = true;
+		}
+		break;
+	case LedFrameType::RleFull:
+		applied = DecodeSpans(frame.payload, frame.size);
+		break;
+	case LedFrameType::Delta:
+	{
+		// valid on top of the base frame or any newer frame before this one
+
+		if (!m_hasFrame || frame.size < 1)
+			break;
+
+		uint8_t base = frame.payload[0];
+
+		if ((int8_t)(m_lastSequence - base) < 0 || (int8_t)(frame.sequence - m_lastSequence) <= 0)
+			break;
+
+		applied = DecodeSpans(frame.payload + 1, frame.size - 1);
+	}
+	break;
+	case LedFrameType::Full565:
+		if (frame.size == numLeds * 2)
+		{
+			for (size_t i = 0; i < numLeds; i++)
+			{
+				uint16_t color = frame.payload[i * 2] | (frame.payload[i * 2 + 1] << 8);
+				uint8_t r = (color >> 8) & 0xF8;
+				uint8_t g = (color >> 3) & 0xFC;
+				uint8_t b = (color << 3) & 0xF8;
+				m_leds[i * 3 + 0] = r | (r >> 5);
+				m_leds[i * 3 + 1] = g | (g >> 6);
+				m_leds[i * 3 + 2] = b | (b >> 5);
+			}
+
+			applied = true;
+		}
+		break;
+	case LedFrameType::Palette:
+	{
+		if (frame.size < 1)
+			break;
+
+		size_t paletteSize = (size_t)frame.payload[0] + 1;
+
+		if (frame.size != 1 + paletteSize * 3 + numLeds)
+			break;
+
+		const uint8_t* palette = frame.payload + 1;
+		const uint8_t* indices = palette + paletteSize * 3;
+
+		applied = true;
+
+		for (size_t i = 0; i < numLeds && applied; i++)
+		{
+			applied = indices[i] < paletteSize;
+
+			if (applied)
+				std::memcpy(&m_leds[i * 3], palette + indices[i] * 3, 3);
+		}
+	}
+	break;
+	default:
+		break;
+	}
+
+	if (applied)
+	{
+		m_lastSequence = frame.sequence;
+		m_hasFrame = true;
+	}
+
+	return applied;
+}
+
+bool LedFrameDecoder::DecodeSpans(const uint8_t* data, size_t size)
+{
+	size_t numLeds = m_leds.size() / 3;
+	size_t led = 0;
+	size_t pos = 0;
+
+	while (pos < size)
+	{
+		if (pos + 3 > size)
+			return false;
+
+		led += data[pos] | (data[pos + 1] << 8);
+		uint8_t op = data[pos + 2];
+		size_t count = (op & 0x7F) + 1;
+		pos += 3;
+
+		if (led + count > numLeds)
+			return false;
+
+		if (op & LED_SPAN_RUN_BIT)
+		{
+			if (pos + 3 > size)
+				return false;
+
+			for (size_t i = 0; i < count; i++)
+				std::memcpy(&m_leds[(led + i) * 3], data + pos, 3);
+
+			pos += 3;
+		}
+		else
+		{
+			if (pos + count * 3 > size)
+				return false;
+
+			std::memcpy(&m_leds[led * 3], data + pos, count * 3);
+			pos += count * 3;
+		}
+
+		led += count;
+	}
+
+	return true;
+}
@@ -0,0 +1,260 @@
+#include "LedFrameEncoder.h"
+#include <cstring>
+#include <cmath>
+
+static bool SameColor(const uint8_t* a, const uint8_t* b)
+{
+	return a[0] == b[0] && a[1] == b[1] && a[2] == b[2];
+}
+
+static float ComputePsnr(const uint8_t* a, const uint8_t* b, size_t size)
+{
+	uint64_t squaredError = 0;
+
+	for (size_t i = 0; i < size; i++)
+	{
+		int difference = (int)a[i] - (int)b[i];
+		squaredError += difference * difference;
+	}
+
+	if (squaredError == 0 || size == 0)
+		return INFINITY;
+
+	return 10.0f * std::log10(255.0f * 255.0f * size / squaredError);
+}
+
+/* LED FRAME ENCODER */
+
+LedFrameEncoder::LedFrameEncoder(uint32_t keyframeInterval)
+{
+	m_keyframeInterval = keyframeInterval;
+	m_framesSinceKeyframe = 0;
+	m_ackedSequence = -1;
+	m_lastFrameType = LedFrameType::Full;
+	m_lastFrameSize = 0;
+	m_lastFramePsnr = INFINITY;
+	m_colorFormat = LedColorFormat::Rgb888;
+	m_supportedFrameTypes = 0xFFFFFFFF;
+}
+
+void LedFrameEncoder::Reset()
+{
+	m_ackedSequence = -1;
+	m_framesSinceKeyframe = 0;
+
+	for (auto& sentFrame : m_history)
+		sentFrame.valid = false;
+}
+
+void LedFrameEncoder::Acknowledge(uint8_t sequence)
+{
+	m_ackedSequence.store(sequence, std::memory_order_release);
+}
+
+const LedFrame& LedFrameEncoder::Encode(const uint8_t* leds, size_t size, LedEncoding encoding)
+{
+	size_t numLeds = size / 3;
+
+	// reduce the colors to the wire format, from here on the leds are what the arduino will show
+
+	LedColorFormat colorFormat = m_colorFormat.load(std::memory_order_relaxed);
+
+	if (encoding == LedEncoding::Quantized && colorFormat == LedColorFormat::Rgb888)
+		colorFormat = LedColorFormat::Rgb565;
+
+	if (colorFormat != LedColorFormat::Rgb888)
+	{
+		m_quantized.resize(size);
+
+		if (colorFormat == LedColorFormat::Rgb565)
+			QuantizeRgb565(leds, numLeds, m_quantized.data());
+		else
+			m_paletteQuantizer.Quantize(leds, numLeds, m_quantized.data());
+
+		m_lastFramePsnr.store(ComputePsnr(leds, m_quantized.data(), size), std::memory_order_relaxed);
+
+		leds = m_quantized.data();
+	}
+	else
+	{
+		m_lastFramePsnr.store(INFINITY, std::memory_order_relaxed);
+	}
+
+	uint8_t sequence = m_builder.GetSequence();
+	int ackedSequence = m_ackedSequence.load(std::memory_order_acquire);
+	uint32_t supportedFrameTypes = m_supportedFrameTypes.load(std::memory_order_relaxed);
+
+	auto supports = [&](LedFrameType type) {
+		return (supportedFrameTypes & (1u << (int)type)) != 0;
+	};
+
+	// a delta needs the acknowledged frame and every frame sent after it
+
+	bool keyframe = encoding == LedEncoding::Full || !supports(LedFrameType::Delta) || ackedSequence < 0 || (m_keyframeInterval > 0 && m_framesSinceKeyframe + 1 >= m_keyframeInterval);
+	uint8_t inFlight = (uint8_t)(sequence - ackedSequence);
+
+	if (!keyframe && (inFlight == 0 || inFlight > s_historySize))
+		keyframe = true;
+
+	m_changed.assign(numLeds, keyframe ? 1 : 0);
+
+	for (uint8_t i = 0; i < inFlight && !keyframe; i++)
+	{
+		const SentFrame& sentFrame = m_history[(uint8_t)(ackedSequence + i) % s_historySize];
+
+		if (!sentFrame.valid || sentFrame.sequence != (uint8_t)(ackedSequence + i) || sentFrame.leds.size() != size)
+		{
+			keyframe = true;
+			break;
+		}
+
+		for (size_t j = 0; j < numLeds; j++)
+		{
+			if (!SameColor(leds + j * 3, sentFrame.leds.data() + j * 3))
+				m_changed[j] = 1;
+		}
+	}
+
+	if (keyframe)
+		m_changed.assign(numLeds, 1);
+
+	// encode the changed leds
+
+	m_payload.clear();
+
+	if (!keyframe)
+		m_payload.push_back((uint8_t)ackedSequence);
+
+	EncodeSpans(leds, numLeds, m_changed.data());
+
+	// smallest fixed size keyframe the color format allows
+
+	LedFrameType keyframeType = LedFrameType::Full;
+	size_t keyframeSize = size;
+
+	if (colorFormat == LedColorFormat::Rgb565 && supports(LedFrameType::Full565) && numLeds * 2 < keyframeSize)
+	{
+		keyframeType = LedFrameType::Full565;
+		keyframeSize = numLeds * 2;
+	}
+	else if (colorFormat == LedColorFormat::Palette && supports(LedFrameType::Palette) && 1 + m_paletteQuantizer.GetPaletteSize() * 3 + numLeds < keyframeSize)
+	{
+		keyframeType = LedFrameType::Palette;
+		keyframeSize = 1 + m_paletteQuantizer.GetPaletteSize() * 3 + numLeds;
+	}
+
+	// pick the frame type, the spans are used only if they are smaller
+
+	LedFrameType type = keyframe ? LedFrameType::RleFull : LedFrameType::Delta;
+	const uint8_t* payload = m_payload.data();
+	size_t payloadSize = m_payload.size();
+
+	if (payloadSize >= keyframeSize || (keyframe && !supports(LedFrameType::RleFull)))
+	{
+		type = keyframeType;
+		payloadSize = keyframeSize;
+
+		switch (keyframeType)
+		{
+		case LedFrameType::Full565:
+			m_keyframePayload.resize(keyframeSize);
+			PackRgb565(leds, numLeds, m_keyframePayload.data());
+			payload = m_keyframePayload.data();
+			break;
+		case LedFrameType::Palette:
+		{
+			const std::vector<uint8_t>& palette = m_paletteQuantizer.GetPalette();
+			const std::vector<uint8_t>& indices = m_paletteQuantizer.GetIndices();
+
+			m_keyframePayload.clear();
+			m_keyframePayload.push_back((uint8_t)(m_paletteQuantizer.GetPaletteSize() - 1));
+			m_keyframePayload.insert(m_keyframePayload.end(), palette.begin(), palette.end());
+			m_keyframePayload.insert(m_keyframePayload.end(), indices.begin(), indices.end());
+			payload = m_keyframePayload.data();
+		}
+		break;
+		default:
+			payload = leds;
+			break;
+		}
+	}
+
+	if (type == LedFrameType::Delta)
+		m_framesSinceKeyframe++;
+	else
+		m_framesSinceKeyframe = 0;
+
+	// remember the frame until it is acknowledged
+
+	SentFrame& sentFrame = m_history[sequence % s_historySize];
+	sentFrame.valid = true;
+	sentFrame.sequence = sequence;
+	sentFrame.leds.assign(leds, leds + size);
+
+	const LedFrame& frame = m_builder.Build(type, payload, payloadSize);
+
+	m_lastFrameType = type;
+	m_lastFrameSize = frame.GetSize();
+
+	return frame;
+}
+
+void LedFrameEncoder::EncodeSpans(const uint8_t* leds, size_t numLeds, const uint8_t* changed)
+{
+	size_t lastEnd = 0;
+	size_t i = 0;
+
+	while (i < numLeds)
+	{
+		if (!changed[i])
+		{
+			i++;
+			continue;
+		}
+
+		// span header (skip), a gap longer than the 16 bits of the skip starts the span on an unchanged led (sent again)
+
+		if (i - lastEnd > 0xFFFF)
+			i = lastEnd + 0xFFFF;
+
+		size_t skip = i - lastEnd;
+		m_payload.push_back((uint8_t)(skip & 0xFF));
+		m_payload.push_back((uint8_t)(skip >> 8));
+
+		// count the leds with the same color
+
+		size_t run = 1;
+
+		while (i + run < numLeds && run < LED_SPAN_MAX_LEDS && changed[i + run] && SameColor(leds + (i + run) * 3, leds + i * 3))
+			run++;
+
+		if (run >= 2)
+		{
+			m_payload.push_back(LED_SPAN_RUN_BIT | (uint8_t)(run - 1));
+			m_payload.insert(m_payload.end(), leds + i * 3, leds + i * 3 + 3);
+			i += run;
+		}
+		else
+		{
+			// literal until an unchanged led or a run of 3 that is cheaper as its own span
+
+			size_t count = 1;
+
+			while (i + count < numLeds && count < LED_SPAN_MAX_LEDS && changed[i + count])
+			{
+				size_t j = i + count;
+
+				if (j + 2 < numLeds && changed[j + 1] && changed[j + 2] && SameColor(leds + j * 3, leds + (j + 1) * 3) && SameColor(leds + j * 3, leds + (j + 2) * 3))
+					break;
+
+				count++;
+			}
+
+			m_payload.push_back((uint8_t)(count - 1));
+			m_payload.insert(m_payload.end(), leds + i * 3, leds + (i + count) * 3);
+			i += count;
+		}
+
+		lastEnd = i;
+	}
+}
@@ -0,0 +1,98 @@
+#include "LedFrameScheduler.h"
+#include <algorithm>
+
+static constexpr float g_averageWeight = 0.1f;
+
+/* LED FRAME SCHEDULER */
+
+LedFrameScheduler::LedFrameScheduler(float targetFps)
+{
+	m_targetFps = targetFps;
+	m_baudBytesPerSecond = 960.0f;
+	m_drainBytesPerSecond = 0.0f;
+	m_currentEncoding = LedEncoding::Full;
+	m_framesSinceProbe = 0;
+
+	for (float& size : m_encodingSizes)
+		size = 0.0f;
+
+	m_encoding = LedEncoding::Full;
+	m_bytesPerSecond = m_baudBytesPerSecond;
+	m_bytesPerFrame = 0.0f;
+}
+
+void LedFrameScheduler::SetBaudRate(unsigned int baudRate)
+{
+	// 8N1, every byte costs 10 bits on the line
+
+	m_baudBytesPerSecond = baudRate / 10.0f;
+	m_drainBytesPerSecond = 0.0f;
+	m_bytesPerSecond = m_baudBytesPerSecond;
+}
+
+LedEncoding LedFrameScheduler::NextEncoding()
+{
+	float bytesPerSecond = m_bytesPerSecond.load(std::memory_order_relaxed);
+	float frameBudget = bytesPerSecond / m_targetFps;
+
+	// best encoding that fits in the frame budget, an encoding never measured is assumed to fit
+
+	LedEncoding encoding = LedEncoding::Quantized;
+
+	if (m_encodingSizes[(int)LedEncoding::Full] <= frameBudget)
+		encoding = LedEncoding::Full;
+	else if (m_encodingSizes[(int)LedEncoding::Delta] <= frameBudget)
+		encoding = LedEncoding::Delta;
+
+	m_encoding.store(encoding, std::memory_order_relaxed);
+
+	// from time to time try the next better encoding, the content may have become cheaper
+
+	m_currentEncoding = encoding;
+
+	if (encoding != LedEncoding::Full && ++m_framesSinceProbe >= s_probeInterval)
+	{
+		m_framesSinceProbe = 0;
+		m_currentEncoding = (LedEncoding)((int)encoding - 1);
+	}
+
+	return m_currentEncoding;
+}
+
+LedFrameScheduler::Clock::duration LedFrameScheduler::OnFrameSent(size_t bytes, Clock::duration writeTime)
+{
+	float& encodingSize = m_encodingSizes[(int)m_currentEncoding];
+	encodingSize = encodingSize == 0.0f ? bytes : encodingSize + (bytes - encodingSize) * g_averageWeight;
+
+	// a write that blocked tells how fast the port really drains, one that didn't block means the port kept up
+	// so the estimate recovers towards the baud rate (and is dropped once it is back there)
+
+	float writeSeconds = std::chrono::duration<float>(writeTime).count();
+
+	if (writeSeconds > 0.001f)
+	{
+		float drain = bytes / writeSeconds;
+		m_drainBytesPerSecond = m_drainBytesPerSecond == 0.0f ? drain : m_drainBytesPerSecond + (drain - m_drainBytesPerSecond) * g_averageWeight;
+	}
+	else if (m_drainBytesPerSecond > 0.0f)
+	{
+		m_drainBytesPerSecond += (m_baudBytesPerSecond - m_drainBytesPerSecond) * g_averageWeight;
+
+		if (m_drainBytesPerSecond >= m_baudBytesPerSecond * 0.99f)
+			m_drainBytesPerSecond = 0.0f;
+	}
+
+	float bytesPerSecond = m_drainBytesPerSecond > 0.0f ? std::min(m_baudBytesPerSecond, m_drainBytesPerSecond) : m_baudBytesPerSecond;
+
+	// stats
+
+	float bytesPerFrame = m_bytesPerFrame.load(std::memory_order_relaxed);
+	m_bytesPerFrame.store(bytesPerFrame == 0.0f ? bytes : bytesPerFrame + (bytes - bytesPerFrame) * g_averageWeight, std::memory_order_relaxed);
+	m_bytesPerSecond.store(bytesPerSecond, std::memory_order_relaxed);
+
+	// wait until the link had time to drain the frame
+
+	float waitSeconds = bytes / bytesPerSecond - writeSeconds;
+
+	return waitSeconds > 0.0f ? std::chrono::duration_cast<Clock::duration>(std::chrono::duration<float>(waitSeconds)) : Clock::duration::zero();
+}
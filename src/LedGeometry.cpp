@@ -0,0 +1,118 @@
+#include "LedGeometry.h"
+#include <iostream>
+#include <algorithm>
+
+/* LED GEOMETRY */
+
+LedGeometry::LedGeometry()
+	: LedGeometry(s_defaultWidth, s_defaultHeight)
+{
+}
+
+LedGeometry::LedGeometry(int width, int height, std::vector<LedPanel> panels, std::vector<LedGroup> groups)
+{
+	if (width <= 0 || height <= 0 || (size_t)width * height > s_maxLeds)
+	{
+		std::cerr << "[WARNING] Invalid led matrix " << width << "x" << height << " (1 to " << s_maxLeds << " leds), using "
+			<< s_defaultWidth << "x" << s_defaultHeight << std::endl;
+
+		width = s_defaultWidth;
+		height = s_defaultHeight;
+		panels.clear();
+	}
+
+	m_width = width;
+	m_height = height;
+
+	// panels, the overlapping panels drive the same leds twice so the chains are limited as well
+
+	size_t numWiredLeds = 0;
+
+	for (const LedPanel& panel : panels)
+	{
+		bool inside = panel.x >= 0 && panel.y >= 0 && panel.width > 0 && panel.height > 0 &&
+			panel.width <= m_width - panel.x && panel.height <= m_height - panel.y;
+
+		if (!inside)
+		{
+			std::cerr << "[WARNING] The led panel at " << panel.x << "," << panel.y << " (" << panel.width << "x" << panel.height << ") is outside the matrix" << std::endl;
+			continue;
+		}
+
+		if (numWiredLeds + (size_t)panel.width * panel.height > s_maxLeds)
+		{
+			std::cerr << "[WARNING] The led panel at " << panel.x << "," << panel.y << " (" << panel.width << "x" << panel.height << ") exceeds " << s_maxLeds << " wired leds" << std::endl;
+			continue;
+		}
+
+		m_panels.push_back(panel);
+		numWiredLeds += (size_t)panel.width * panel.height;
+	}
+
+	if (m_panels.empty())
+		m_panels.push_back({ 0, 0, m_width, m_height, LedWiring::ROW_MAJOR });
+
+	// wiring order, chain after chain
+
+	for (const LedPanel& panel : m_panels)
+	{
+		for (int row = 0; row < panel.height; row++)
+		{
+			bool reversed = panel.wiring == LedWiring::SERPENTINE && (row & 1);
+
+			for (int column = 0; column < panel.width; column++)
+			{
+				int x = panel.x + (reversed ? panel.width - 1 - column : column);
+				m_wiringOrder.push_back((uint32_t)(x + (panel.y + row) * m_width));
+			}
+		}
+	}
+
+	m_matrixOrder = m_wiringOrder.size() == GetNumLeds();
+
+	for (size_t i = 0; m_matrixOrder && i < m_wiringOrder.size(); i++)
+		m_matrixOrder = m_wiringOrder[i] == i;
+
+	// groups
+
+	for (LedGroup& group : groups)
+	{
+		int beginX = std::clamp(group.x, 0, m_width);
+		int beginY = std::clamp(group.y, 0, m_height);
+		int endX = (int)std::clamp<int64_t>((int64_t)group.x + group.width, beginX, m_width);
+		int endY = (int)std::clamp<int64_t>((int64_t)group.y + group.height, beginY, m_height);
+
+		group.x = beginX;
+		group.y = beginY;
+		group.width = endX - beginX;
+		group.height = endY - beginY;
+
+		m_groups.push_back(std::move(group));
+	}
+}
+
+const LedGroup* LedGeometry::FindGroup(std::string_view name) const
+{
+	for (const LedGroup& group : m_groups)
+	{
+		if (group.name == name)
+			return &group;
+	}
+
+	return nullptr;
+}
+
+void LedGeometry::ToWiringOrder(const uint8_t* matrix, uint8_t* wired) const
+{
+	const uint32_t* wiringOrder = m_wiringOrder.data();
+	size_t numWiredLeds = m_wiringOrder.size();
+
+	for (size_t i = 0; i < numWiredLeds; i++)
+	{
+		const uint8_t* led = matrix + (size_t)wiringOrder[i] * 3;
+
+		wired[i * 3 + 0] = led[0];
+		wired[i * 3 + 1] = led[1];
+		wired[i * 3 + 2] = led[2];
+	}
+}
@@ -0,0 +1,74 @@
+#include "LedProtocol.h"
+#include <cstring>
+#include <cassert>
+
+uint16_t LedFrameCrc16(const uint8_t* data, size_t size, uint16_t crc)
+{
+	for (size_t i = 0; i < size; i++)
+	{
+		crc ^= (uint16_t)data[i] << 8;
+
+		for (int bit = 0; bit < 8; bit++)
+		{
+			crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : (crc << 1);
+		}
+	}
+
+	return crc;
+}
+
+void LedFrame::CopyTo(std::vector<uint8_t>& frame) const
+{
+	frame.resize(GetSize());
+
+	std::memcpy(frame.data(), header, LED_FRAME_HEADER_SIZE);
+
+	if (payloadSize > 0)
+	{
+		std::memcpy(frame.data() + LED_FRAME_HEADER_SIZE, payload, payloadSize);
+	}
+
+	std::memcpy(frame.data() + LED_FRAME_HEADER_SIZE + payloadSize, trailer, LED_FRAME_TRAILER_SIZE);
+}
+
+/* LED FRAME BUILDER */
+
+LedFrameBuilder::LedFrameBuilder()
+{
+	m_frame = {};
+	m_sequence = 0;
+}
+
+const LedFrame& LedFrameBuilder::Build(LedFrameType type, const void* payload, size_t size)
+{
+	uint8_t* header = m_frame.header;
+
+	// the length field is 16 bits, the geometry keeps every frame under it
+
+	assert(size <= LED_FRAME_MAX_PAYLOAD_SIZE);
+
+	// header
+
+	header[0] = LED_FRAME_MAGIC_0;
+	header[1] = LED_FRAME_MAGIC_1;
+	header[2] = LED_FRAME_VERSION;
+	header[3] = (uint8_t)type;
+	header[4] = (uint8_t)(size & 0xFF);
+	header[5] = (uint8_t)(size >> 8);
+	header[6] = m_sequence++;
+
+	// payload (in place)
+
+	m_frame.payload = (const uint8_t*)payload;
+	m_frame.payloadSize = size;
+
+	// trailer, the crc continues from the header into the payload
+
+	uint16_t crc = LedFrameCrc16(header + 2, LED_FRAME_HEADER_SIZE - 2);
+	crc = LedFrameCrc16(m_frame.payload, size, crc);
+
+	m_frame.trailer[0] = (uint8_t)(crc & 0xFF);
+	m_frame.trailer[1] = (uint8_t)(crc >> 8);
+
+	return m_frame;
+}
@@ -0,0 +1,146 @@
+#include "LedQuantizer.h"
+#include <algorithm>
+
+static constexpr size_t g_numBuckets = 1 << 16;
+static constexpr size_t g_maxPaletteSize = 256;
+
+static inline uint16_t ToRgb565(uint8_t r, uint8_t g, uint8_t b)
+{
+	return (uint16_t)(((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3));
+}
+
+// the loops below work on plain arrays without branches so the compiler can vectorize them
+
+void PackRgb565(const uint8_t* leds, size_t numLeds, uint8_t* packed)
+{
+	for (size_t i = 0; i < numLeds; i++)
+	{
+		uint16_t color = ToRgb565(leds[i * 3 + 0], leds[i * 3 + 1], leds[i * 3 + 2]);
+		packed[i * 2 + 0] = (uint8_t)(color & 0xFF);
+		packed[i * 2 + 1] = (uint8_t)(color >> 8);
+	}
+}
+
+void QuantizeRgb565(const uint8_t* leds, size_t numLeds, uint8_t* quantized)
+{
+	// expand the bits back the same way the arduino does (replicating the high bits)
+
+	for (size_t i = 0; i < numLeds * 3; i += 3)
+	{
+		uint8_t r = leds[i + 0] & 0xF8;
+		uint8_t g = leds[i + 1] & 0xFC;
+		uint8_t b = leds[i + 2] & 0xF8;
+		quantized[i + 0] = r | (r >> 5);
+		quantized[i + 1] = g | (g >> 6);
+		quantized[i + 2] = b | (b >> 5);
+	}
+}
+
+/* LED PALETTE QUANTIZER */
+
+LedPaletteQuantizer::LedPaletteQuantizer()
+	: m_counts(g_numBuckets, 0), m_sums(g_numBuckets * 3, 0), m_lookup(g_numBuckets, 0)
+{
+}
+
+void LedPaletteQuantizer::Quantize(const uint8_t* leds, size_t numLeds, uint8_t* quantized)
+{
+	// bucket keys
+
+	m_keys.resize(numLeds);
+
+	for (size_t i = 0; i < numLeds; i++)
+		m_keys[i] = ToRgb565(leds[i * 3 + 0], leds[i * 3 + 1], leds[i * 3 + 2]);
+
+	// histogram (only the buckets used are touched so the cost doesn't depend on the 65536 buckets)
+
+	m_usedKeys.clear();
+
+	for (size_t i = 0; i < numLeds; i++)
+	{
+		uint16_t key = m_keys[i];
+
+		if (m_counts[key]++ == 0)
+			m_usedKeys.push_back(key);
+
+		m_sums[key * 3 + 0] += leds[i * 3 + 0];
+		m_sums[key * 3 + 1] += leds[i * 3 + 1];
+		m_sums[key * 3 + 2] += leds[i * 3 + 2];
+	}
+
+	// keep the most used buckets
+
+	size_t paletteSize = std::min(m_usedKeys.size(), g_maxPaletteSize);
+
+	if (m_usedKeys.size() > g_maxPaletteSize)
+	{
+		std::partial_sort(m_usedKeys.begin(), m_usedKeys.begin() + paletteSize, m_usedKeys.end(), [&](uint16_t a, uint16_t b) {
+			return m_counts[a] > m_counts[b];
+		});
+	}
+
+	// the palette entry of a bucket is the average of its colors
+
+	m_palette.resize(paletteSize * 3);
+
+	for (size_t i = 0; i < paletteSize; i++)
+	{
+		uint16_t key = m_usedKeys[i];
+		uint32_t count = m_counts[key];
+
+		m_palette[i * 3 + 0] = (uint8_t)((m_sums[key * 3 + 0] + count / 2) / count);
+		m_palette[i * 3 + 1] = (uint8_t)((m_sums[key * 3 + 1] + count / 2) / count);
+		m_palette[i * 3 + 2] = (uint8_t)((m_sums[key * 3 + 2] + count / 2) / count);
+		m_lookup[key] = (uint8_t)i;
+	}
+
+	// the buckets left out map to the nearest palette entry
+
+	for (size_t i = paletteSize; i < m_usedKeys.size(); i++)
+	{
+		uint16_t key = m_usedKeys[i];
+		uint32_t count = m_counts[key];
+		int r = (int)(m_sums[key * 3 + 0] / count);
+		int g = (int)(m_sums[key * 3 + 1] / count);
+		int b = (int)(m_sums[key * 3 + 2] / count);
+
+		int bestDistance = INT32_MAX;
+
+		for (size_t j = 0; j < paletteSize; j++)
+		{
+			int dr = r - m_palette[j * 3 + 0];
+			int dg = g - m_palette[j * 3 + 1];
+			int db = b - m_palette[j * 3 + 2];
+			int distance = dr * dr + dg * dg + db * db;
+
+			if (distance < bestDistance)
+			{
+				bestDistance = distance;
+				m_lookup[key] = (uint8_t)j;
+			}
+		}
+	}
+
+	// indices & the colors shown
+
+	m_indices.resize(numLeds);
+
+	for (size_t i = 0; i < numLeds; i++)
+	{
+		uint8_t index = m_lookup[m_keys[i]];
+		m_indices[i] = index;
+		quantized[i * 3 + 0] = m_palette[index * 3 + 0];
+		quantized[i * 3 + 1] = m_palette[index * 3 + 1];
+		quantized[i * 3 + 2] = m_palette[index * 3 + 2];
+	}
+
+	// clear the buckets for the next frame
+
+	for (uint16_t key : m_usedKeys)
+	{
+		m_counts[key] = 0;
+		m_sums[key * 3 + 0] = 0;
+		m_sums[key * 3 + 1] = 0;
+		m_sums[key * 3 + 2] = 0;
+	}
+}
@@ -0,0 +1,271 @@
+#include "LuaLedBuffer.h"
+#include <algorithm>
+#include <cstring>
+
+extern "C"
+{
+#include <lua.h>
+#include <lualib.h>
+#include <lauxlib.h>
+}
+
+static inline lua_Integer GetColor(const uint8_t* led)
+{
+	return ((lua_Integer)led[0] << 16) | ((lua_Integer)led[1] << 8) | led[2];
+}
+
+static inline void SetColor(uint8_t* led, uint32_t color)
+{
+	led[0] = (uint8_t)(color >> 16);
+	led[1] = (uint8_t)(color >> 8);
+	led[2] = (uint8_t)color;
+}
+
+// same color in a run of leds, the first one is written and then copied over doubling sizes
+
+static void FillLeds(uint8_t* leds, size_t numLeds, uint32_t color)
+{
+	size_t size = numLeds * 3;
+
+	if (size == 0)
+		return;
+
+	SetColor(leds, color);
+
+	for (size_t filled = 3; filled < size; filled *= 2)
+		std::memcpy(leds + filled, leds, std::min(filled, size - filled));
+}
+
+/* LUA LED BUFFER */
+
+void LuaLedBuffer::Register(lua_State* l, const char* name, LedBuffer& leds, const LedGeometry& geometry)
+{
+	View* view = (View*)lua_newuserdatauv(l, sizeof(View), 0);
+	*view = { &leds, &geometry };
+
+	// the methods are reached through __index (after the led indices)
+
+	if (luaL_newmetatable(l, s_metatableName))
+	{
+		static const luaL_Reg methods[] = {
+			{ "fill", FillLuaWrap },
+			{ "set_row", SetRowLuaWrap },
+			{ "set_rect", SetRectLuaWrap },
+			{ "blit", BlitLuaWrap },
+			{ "group", GroupLuaWrap },
+			{ nullptr, nullptr }
+		};
+
+		luaL_newlib(l, methods);
+		lua_pushcclosure(l, IndexLuaWrap, 1);
+		lua_setfield(l, -2, "__index");
+
+		lua_pushcfunction(l, NewIndexLuaWrap);
+		lua_setfield(l, -2, "__newindex");
+
+		lua_pushcfunction(l, LengthLuaWrap);
+		lua_setfield(l, -2, "__len");
+	}
+
+	lua_setmetatable(l, -2);
+	lua_setglobal(l, name);
+}
+
+LuaLedBuffer::View* LuaLedBuffer::CheckView(lua_State* l)
+{
+	return (View*)luaL_checkudata(l, 1, s_metatableName);
+}
+
+void LuaLedBuffer::FillRect(const View& view, int x, int y, int width, int height, uint32_t color)
+{
+	// clipped (in 64 bits so x + width can't overflow)
+
+	int64_t beginX = std::max<int64_t>(x, 0);
+	int64_t beginY = std::max<int64_t>(y, 0);
+	int64_t endX = std::min<int64_t>((int64_t)x + width, view.GetWidth());
+	int64_t endY = std::min<int64_t>((int64_t)y + height, view.GetHeight());
+
+	if (beginX >= endX || beginY >= endY)
+		return;
+
+	// whole rows are contiguous
+
+	if (beginX == 0 && endX == view.GetWidth())
+	{
+		FillLeds(view.GetData() + beginY * view.GetWidth() * 3, (size_t)((endY - beginY) * view.GetWidth()), color);
+		return;
+	}
+
+	for (int64_t row = beginY; row < endY; row++)
+		FillLeds(view.GetData() + (beginX + row * view.GetWidth()) * 3, (size_t)(endX - beginX), color);
+}
+
+int LuaLedBuffer::IndexLuaWrap(lua_State* l)
+{
+	// only reached through the metatable, the first argument is always a led buffer
+
+	const View* view = (const View*)lua_touserdata(l, 1);
+
+	if (lua_type(l, 2) == LUA_TNUMBER)
+	{
+		int isInteger = 0;
+		lua_Integer index = lua_tointegerx(l, 2, &isInteger);
+
+		if (isInteger && (lua_Unsigned)index < view->GetNumLeds())
+			lua_pushinteger(l, GetColor(view->GetData() + index * 3));
+		else
+			lua_pushnil(l);
+
+		return 1;
+	}
+
+	const char* key = lua_tostring(l, 2);
+
+	if (key && std::strcmp(key, "width") == 0)
+	{
+		lua_pushinteger(l, view->GetWidth());
+		return 1;
+	}
+
+	if (key && std::strcmp(key, "height") == 0)
+	{
+		lua_pushinteger(l, view->GetHeight());
+		return 1;
+	}
+
+	lua_pushvalue(l, 2);
+	lua_rawget(l, lua_upvalueindex(1));
+	return 1;
+}
+
+int LuaLedBuffer::NewIndexLuaWrap(lua_State* l)
+{
+	const View* view = (const View*)lua_touserdata(l, 1);
+	int isInteger = 0;
+	lua_Integer index = lua_tointegerx(l, 2, &isInteger);
+	lua_Integer color = luaL_checkinteger(l, 3);
+
+	if (!isInteger || (lua_Unsigned)index >= view->GetNumLeds())
+		return luaL_error(l, "led index %s out of range", luaL_tolstring(l, 2, nullptr));
+
+	SetColor(view->GetData() + index * 3, (uint32_t)color);
+	return 0;
+}
+
+int LuaLedBuffer::LengthLuaWrap(lua_State* l)
+{
+	const View* view = (const View*)lua_touserdata(l, 1);
+	lua_pushinteger(l, (lua_Integer)view->GetNumLeds());
+	return 1;
+}
+
+int LuaLedBuffer::FillLuaWrap(lua_State* l)
+{
+	const View* view = CheckView(l);
+	FillLeds(view->GetData(), view->GetNumLeds(), (uint32_t)luaL_checkinteger(l, 2));
+	return 0;
+}
+
+int LuaLedBuffer::SetRowLuaWrap(lua_State* l)
+{
+	const View* view = CheckView(l);
+	lua_Integer y = luaL_checkinteger(l, 2);
+
+	if (lua_type(l, 3) != LUA_TTABLE)
+	{
+		lua_Integer color = luaL_checkinteger(l, 3);
+
+		if (y >= 0 && y < view->GetHeight())
+			FillRect(*view, 0, (int)y, view->GetWidth(), 1, (uint32_t)color);
+
+		return 0;
+	}
+
+	if (y < 0 || y >= view->GetHeight())
+		return 0;
+
+	// until the end of the row or the first missing color
+
+	uint8_t* row = view->GetData() + y * view->GetWidth() * 3;
+
+	for (int x = 0; x < view->GetWidth(); x++)
+	{
+		int isInteger = 0;
+		lua_rawgeti(l, 3, x + 1);
+		lua_Integer color = lua_tointegerx(l, -1, &isInteger);
+		lua_pop(l, 1);
+
+		if (!isInteger)
+			break;
+
+		SetColor(row + x * 3, (uint32_t)color);
+	}
+
+	return 0;
+}
+
+int LuaLedBuffer::SetRectLuaWrap(lua_State* l)
+{
+	const View* view = CheckView(l);
+	int x = (int)luaL_checkinteger(l, 2);
+	int y = (int)luaL_checkinteger(l, 3);
+	int width = (int)luaL_checkinteger(l, 4);
+	int height = (int)luaL_checkinteger(l, 5);
+	lua_Integer color = luaL_checkinteger(l, 6);
+
+	FillRect(*view, x, y, width, height, (uint32_t)color);
+	return 0;
+}
+
+int LuaLedBuffer::BlitLuaWrap(lua_State* l)
+{
+	const View* view = CheckView(l);
+	int x = (int)luaL_checkinteger(l, 2);
+	int y = (int)luaL_checkinteger(l, 3);
+	int width = (int)luaL_checkinteger(l, 4);
+	int height = (int)luaL_checkinteger(l, 5);
+	luaL_checktype(l, 6, LUA_TTABLE);
+
+	// only the part of the source inside the buffer is read, the missing colors leave their leds as they are
+
+	int64_t beginColumn = std::max<int64_t>(-(int64_t)x, 0);
+	int64_t beginRow = std::max<int64_t>(-(int64_t)y, 0);
+	int64_t endColumn = std::min<int64_t>(width, (int64_t)view->GetWidth() - x);
+	int64_t endRow = std::min<int64_t>(height, (int64_t)view->GetHeight() - y);
+
+	for (int64_t row = beginRow; row < endRow; row++)
+	{
+		uint8_t* leds = view->GetData() + ((y + row) * view->GetWidth() + x) * 3;
+
+		for (int64_t column = beginColumn; column < endColumn; column++)
+		{
+			int isInteger = 0;
+			lua_rawgeti(l, 6, 1 + column + row * width);
+			lua_Integer color = lua_tointegerx(l, -1, &isInteger);
+			lua_pop(l, 1);
+
+			if (isInteger)
+				SetColor(leds + column * 3, (uint32_t)color);
+		}
+	}
+
+	return 0;
+}
+
+int LuaLedBuffer::GroupLuaWrap(lua_State* l)
+{
+	const View* view = CheckView(l);
+	const LedGroup* group = view->geometry->FindGroup(luaL_checkstring(l, 2));
+
+	if (!group)
+	{
+		lua_pushnil(l);
+		return 1;
+	}
+
+	lua_pushinteger(l, group->x);
+	lua_pushinteger(l, group->y);
+	lua_pushinteger(l, group->width);
+	lua_pushinteger(l, group->height);
+	return 4;
+}
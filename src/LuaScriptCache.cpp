@@ -0,0 +1,175 @@
+#include "LuaScriptCache.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <filesystem>
+#include <cstdio>
+#include <cstring>
+
+extern "C"
+{
+#include <lua.h>
+#include <lualib.h>
+#include <lauxlib.h>
+}
+
+std::mutex LuaScriptCache::s_mutex;
+
+static bool ReadFile(const std::filesystem::path& path, std::string& data)
+{
+	std::ifstream file(path, std::ios::binary);
+
+	if (!file)
+		return false;
+
+	std::ostringstream stream;
+	stream << file.rdbuf();
+	data = stream.str();
+
+	return !file.bad();
+}
+
+static std::string ToHex(uint64_t value)
+{
+	char hex[17];
+	std::snprintf(hex, sizeof(hex), "%016llx", (unsigned long long)value);
+	return hex;
+}
+
+// header in front of the bytecode of an entry, checked before the bytecode reaches lua_load (which doesn't verify it and
+// can crash on a malformed chunk)
+
+struct EntryHeader
+{
+	char magic[4];
+	uint32_t luaVersion;
+	uint64_t sourceHash;
+	uint64_t bytecodeSize;
+	uint64_t bytecodeHash;
+};
+
+static constexpr char g_entryMagic[4] = { 'L', 'S', 'C', '1' };
+
+static int DumpWriter(lua_State*, const void* data, size_t size, void* userData)
+{
+	((std::string*)userData)->append((const char*)data, size);
+	return 0;
+}
+
+/* LUA SCRIPT CACHE */
+
+int LuaScriptCache::LoadFile(lua_State* l, const std::string& path)
+{
+	std::string source;
+
+	// unreadable, luaL_loadfile reports it
+
+	if (!ReadFile(path, source))
+		return luaL_loadfile(l, path.c_str());
+
+	// <hash of the path>-<hash of the source>.luac, so a script has one entry that is replaced when it changes
+
+	std::string chunkName = "@" + path;
+	uint64_t sourceHash = Hash(source);
+	std::string entryPrefix = ToHex(Hash(path)) + "-";
+	std::filesystem::path entryPath = std::filesystem::path(s_directory) / (entryPrefix + ToHex(sourceHash) + ".luac");
+
+	std::string entry;
+
+	if (ReadFile(entryPath, entry) && entry.size() >= sizeof(EntryHeader))
+	{
+		EntryHeader header;
+		std::memcpy(&header, entry.data(), sizeof(header));
+		std::string_view bytecode = std::string_view(entry).substr(sizeof(header));
+
+		// truncated, corrupted, from another lua build or for another source, compiled again
+
+		bool valid = std::memcmp(header.magic, g_entryMagic, sizeof(g_entryMagic)) == 0 && header.luaVersion == LUA_VERSION_RELEASE_NUM &&
+			header.sourceHash == sourceHash && header.bytecodeSize == bytecode.size() && header.bytecodeHash == Hash(bytecode);
+
+		if (valid)
+		{
+			if (luaL_loadbufferx(l, bytecode.data(), bytecode.size(), chunkName.c_str(), "b") == LUA_OK)
+				return LUA_OK;
+
+			lua_pop(l, 1);
+		}
+	}
+
+	int result = luaL_loadbufferx(l, source.data(), source.size(), chunkName.c_str(), "t");
+	std::string bytecode;
+
+	if (result != LUA_OK || lua_dump(l, DumpWriter, &bytecode, 0) != 0)
+		return result;
+
+	EntryHeader header;
+	std::memcpy(header.magic, g_entryMagic, sizeof(g_entryMagic));
+	header.luaVersion = LUA_VERSION_RELEASE_NUM;
+	header.sourceHash = sourceHash;
+	header.bytecodeSize = bytecode.size();
+	header.bytecodeHash = Hash(bytecode);
+
+	// written aside & renamed so a reader never sees half an entry, then the old entries of the script are removed
+
+	std::lock_guard<std::mutex> lock(s_mutex);
+	std::error_code error;
+	std::filesystem::create_directories(s_directory, error);
+
+	std::filesystem::path temporaryPath = entryPath;
+	temporaryPath += ".tmp";
+
+	{
+		std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+		file.write((const char*)&header, sizeof(header));
+		file.write(bytecode.data(), bytecode.size());
+
+		if (!file)
+		{
+			std::cerr << "[WARNING] The bytecode of " << path << " couldn't be cached in " << s_directory << std::endl;
+			return result;
+		}
+	}
+
+	std::filesystem::rename(temporaryPath, entryPath, error);
+
+	if (error)
+	{
+		std::filesystem::remove(temporaryPath, error);
+		return result;
+	}
+
+	for (const auto& entry : std::filesystem::directory_iterator(s_directory, error))
+	{
+		std::string fileName = entry.path().filename().string();
+
+		if (fileName.starts_with(entryPrefix) && entry.path() != entryPath)
+			std::filesystem::remove(entry.path(), error);
+	}
+
+	return result;
+}
+
+int LuaScriptCache::DoFile(lua_State* l, const std::string& path)
+{
+	int result = LoadFile(l, path);
+
+	if (result != LUA_OK)
+		return result;
+
+	return lua_pcall(l, 0, LUA_MULTRET, 0);
+}
+
+uint64_t LuaScriptCache::Hash(std::string_view data)
+{
+	// fnv-1a
+
+	uint64_t hash = 14695981039346656037ull;
+
+	for (char c : data)
+	{
+		hash ^= (uint8_t)c;
+		hash *= 1099511628211ull;
+	}
+
+	return hash;
+}
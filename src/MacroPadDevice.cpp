@@ -0,0 +1,772 @@
+#include "MacroPadDevice.h"
+#include <iostream>
+#include <cstring>
+#include <charconv>
+#include <algorithm>
+
+// rates tried by the negotiation, from the fastest
+
+static const unsigned int g_baudRates[] = { 2000000, 1000000, 500000, 250000, 230400, 115200, 57600, 38400, 19200 };
+
+static constexpr auto g_linkCheckInterval = std::chrono::seconds(1);
+static constexpr auto g_linkTimeout = std::chrono::seconds(3);
+static constexpr auto g_baudRequestTimeout = std::chrono::seconds(3); // a SetBaud unanswered this long is requested again
+static constexpr uint32_t g_maxUnackedFrames = 120;
+static constexpr unsigned int g_defaultCoalesceWindowMs = 15;
+
+static int64_t ToMicroseconds(LedFrameScheduler::Clock::time_point time)
+{
+	return std::chrono::duration_cast<std::chrono::microseconds>(time.time_since_epoch()).count();
+}
+
+// parse the unsigned numbers separated by spaces of a line, returns how many were parsed
+
+static int ParseNumbers(std::string_view text, uint32_t* numbers, int count)
+{
+	int parsed = 0;
+	const char* it = text.data();
+	const char* end = text.data() + text.size();
+
+	while (parsed < count && it < end)
+	{
+		while (it < end && *it == ' ')
+			it++;
+
+		auto [ptr, ec] = std::from_chars(it, end, numbers[parsed]);
+
+		if (ec != std::errc())
+			break;
+
+		it = ptr;
+		parsed++;
+	}
+
+	return parsed;
+}
+
+/* MACRO PAD DEVICE */
+
+MacroPadDevice::MacroPadDevice(asio::io_context& io, const std::string& portName, unsigned int baudRate, ProfileManager& profileManager, ActionExecutor& actionExecutor)
+	: m_strand(asio::make_strand(io)), m_port(m_strand), m_pacingTimer(m_strand), m_linkTimer(m_strand), m_coalesceTimer(m_strand), m_profileManager(profileManager), m_actionExecutor(actionExecutor)
+{
+	m_portName = portName;
+	m_baseBaudRate = baudRate;
+	m_maxBaudRate = g_baudRates[0];
+	m_baudRate = baudRate;
+	m_open = false;
+	m_deviceNumLeds = 0;
+	m_deviceFrameTypes = 0;
+	m_deviceMaxBaudRate = 0;
+	m_requestedBaudRate = 0;
+	m_unackedFrames = 0;
+	m_usingCommandIds = false;
+	m_coalesceWindowMs = g_defaultCoalesceWindowMs;
+	m_commandTableGeneration = m_profileManager.GetGeneration();
+	m_commandTable = m_profileManager.GetActiveTable();
+	m_coalesceCommandId = CommandTable::s_invalidId;
+	m_coalescedRepeats = 0;
+	m_commandsReceived = 0;
+	m_actionsDispatched = 0;
+	m_hasClockOffset = false;
+	m_clockOffset = 0;
+	m_clockOffsetRoundTrip = 0;
+	m_helloSequence = 0;
+	m_lastDeviceTime = 0;
+	m_deviceTimeWraps = 0;
+	m_receiveSize = 0;
+	m_sendQueued = false;
+	m_sending = false;
+#ifdef _WIN32
+	m_gatherWrites = false;
+#else
+	m_gatherWrites = true;
+#endif
+	m_writeAccounted = 0;
+	m_writeCalls = 0;
+	m_writesCompleted = 0;
+	m_bytesWritten = 0;
+	m_usbPackets = 0;
+	m_framesWritten = 0;
+	m_framesAcknowledged = 0;
+	m_writtenFps = 0.0f;
+	m_acknowledgedFps = 0.0f;
+}
+
+MacroPadDevice::~MacroPadDevice()
+{
+}
+
+bool MacroPadDevice::Open()
+{
+	try
+	{
+		m_port.open(m_portName);
+		m_port.set_option(asio::serial_port_base::baud_rate(m_baseBaudRate)); // Set baud rate to match Arduino
+	}
+	catch (const asio::system_error& e)
+	{
+		std::cerr << "Error: " << e.what() << std::endl;
+
+		return false;
+	}
+
+	// the arduino has no frame to build deltas on yet
+
+	m_receiveSize = 0;
+	m_baudRate = m_baseBaudRate;
+	m_deviceCommandIds.clear();
+	m_deviceCommandNames.clear();
+	m_usingCommandIds = false;
+	m_frameEncoder.Reset();
+	m_frameScheduler.SetBaudRate(m_baseBaudRate);
+	m_lastReceiveTime = LedFrameScheduler::Clock::now();
+	m_fpsTime = m_lastReceiveTime;
+	m_framesWritten = 0;
+	m_framesAcknowledged = 0;
+	m_open = true;
+
+	// start listening and ask for the capabilities on the strand
+
+	asio::post(m_strand, [self = shared_from_this()]() {
+		self->StartCommandRead();
+		self->SendControlFrame(LedFrameType::Hello, nullptr, 0);
+		self->StartLinkTimer();
+	});
+
+	return true;
+}
+
+void MacroPadDevice::Close()
+{
+	m_open = false;
+
+	// closing the port cancels the pending operations, the handlers keep the device alive until they run
+
+	asio::post(m_strand, [self = shared_from_this()]() {
+		asio::error_code error;
+		self->m_pacingTimer.cancel();
+		self->m_linkTimer.cancel();
+		self->m_coalesceTimer.cancel();
+		self->m_coalesceCommandId = CommandTable::s_invalidId;
+		self->m_port.close(error);
+	});
+}
+
+void MacroPadDevice::ResetLatencyStats()
+{
+	m_latencyStats.receive.Reset();
+	m_latencyStats.parse.Reset();
+	m_latencyStats.dispatch.Reset();
+}
+
+void MacroPadDevice::ResetWriteStats()
+{
+	m_writeCalls = 0;
+	m_writesCompleted = 0;
+	m_bytesWritten = 0;
+	m_usbPackets = 0;
+}
+
+void MacroPadDevice::PublishLeds(const uint8_t* leds, size_t size)
+{
+	if (!m_open)
+		return;
+
+	std::vector<uint8_t>& ledsBuffer = m_ledsTripleBuffer.GetWriteBuffer();
+	ledsBuffer.assign(leds, leds + size);
+	m_ledsTripleBuffer.Publish();
+
+	// only one send attempt is queued at a time, it will pick up the newest frame
+
+	if (!m_sendQueued.exchange(true))
+	{
+		asio::post(m_strand, [self = shared_from_this()]() {
+			self->m_sendQueued = false;
+			self->TrySend();
+		});
+	}
+}
+
+void MacroPadDevice::StartCommandRead()
+{
+	// read whatever is available after the pending partial line
+
+	m_port.async_read_some(asio::buffer(m_receiveBuffer + m_receiveSize, s_receiveBufferSize - m_receiveSize),
+		[self = shared_from_this()](const asio::error_code& error, size_t bytesRead) {
+			self->OnCommandRead(error, bytesRead);
+		});
+}
+
+void MacroPadDevice::OnCommandRead(const asio::error_code& error, size_t bytesRead)
+{
+	// port closed or failed, stop listening
+
+	if (error)
+		return;
+
+	auto readTime = LedFrameScheduler::Clock::now();
+
+	m_receiveSize += bytesRead;
+
+	// split all the complete lines received and process them straight from the buffer
+
+	const char* lineBegin = m_receiveBuffer;
+	const char* end = m_receiveBuffer + m_receiveSize;
+
+	while (const char* lineEnd = (const char*)std::memchr(lineBegin, '\n', end - lineBegin))
+	{
+		std::string_view line(lineBegin, lineEnd - lineBegin);
+
+		// the arduino println ends lines with \r\n
+
+		if (!line.empty() && line.back() == '\r')
+			line.remove_suffix(1);
+
+		if (!line.empty())
+			ProcessLine(line, readTime);
+
+		lineBegin = lineEnd + 1;
+	}
+
+	// keep the partial line at the start of the buffer (drop it if it doesn't fit, it isn't a valid command)
+
+	size_t remaining = end - lineBegin;
+
+	if (remaining == s_receiveBufferSize)
+		remaining = 0;
+	else if (remaining > 0 && lineBegin != m_receiveBuffer)
+		std::memmove(m_receiveBuffer, lineBegin, remaining);
+
+	m_receiveSize = remaining;
+
+	StartCommandRead();
+}
+
+void MacroPadDevice::ProcessLine(std::string_view line, LedFrameScheduler::Clock::time_point readTime)
+{
+	if (line.substr(0, 4) == "ACK ")
+	{
+		// led frame acknowledged by the arduino
+
+		unsigned int sequence;
+		auto [ptr, ec] = std::from_chars(line.data() + 4, line.data() + line.size(), sequence);
+
+		if (ec == std::errc())
+		{
+			m_frameEncoder.Acknowledge((uint8_t)sequence);
+			m_lastReceiveTime = LedFrameScheduler::Clock::now();
+			m_unackedFrames = 0;
+			m_framesAcknowledged++;
+		}
+
+		return;
+	}
+
+	if (line.substr(0, 5) == "CAPS ")
+	{
+		// CAPS <num leds> <supported frame types> <max baud> [<arduino micros> <hello seq>]
+		// a late answer to an older hello can't be timed against the last one sent, so it gives no clock sample
+
+		uint32_t capabilities[5];
+		int count = ParseNumbers(line.substr(5), capabilities, 5);
+
+		if (count >= 3)
+		{
+			m_lastReceiveTime = LedFrameScheduler::Clock::now();
+
+			if (count == 5 && capabilities[4] == m_helloSequence)
+				OnClockSample(capabilities[3], readTime);
+
+			OnCapabilities(capabilities[0], capabilities[1], capabilities[2]);
+		}
+
+		return;
+	}
+
+	if (line.substr(0, 5) == "BAUD ")
+	{
+		// the arduino switches right after this line
+
+		uint32_t baudRate;
+
+		if (ParseNumbers(line.substr(5), &baudRate, 1) == 1)
+		{
+			m_requestedBaudRate = 0;
+			SetPortBaudRate(baudRate);
+		}
+
+		return;
+	}
+
+	// one atomic load per line, the table is only loaded again after a profile switch or a new config
+
+	if (m_profileManager.GetGeneration() != m_commandTableGeneration)
+		OnCommandTablePublished();
+
+	if (line.substr(0, 5) == "CMDS ")
+	{
+		OnCommandIds(line.substr(5));
+		return;
+	}
+
+	// <command>[\t<arduino micros>] or #<device command id>[\t<arduino micros>]
+
+	size_t separator = line.find('\t');
+	std::string_view command = line.substr(0, separator);
+	uint32_t deviceTime = 0;
+	bool hasDeviceTime = separator != std::string_view::npos && ParseNumbers(line.substr(separator + 1), &deviceTime, 1) == 1;
+	uint16_t commandId = CommandTable::s_invalidId;
+
+	if (!command.empty() && command[0] == '#')
+	{
+		uint32_t deviceCommandId;
+
+		if (ParseNumbers(command.substr(1), &deviceCommandId, 1) == 1 && deviceCommandId < m_deviceCommandIds.size())
+			commandId = m_deviceCommandIds[deviceCommandId];
+	}
+	else
+	{
+		commandId = m_commandTable->Find(command);
+	}
+
+	if (commandId != CommandTable::s_invalidId)
+		ProcessCommand(commandId, deviceTime, hasDeviceTime, readTime);
+}
+
+void MacroPadDevice::OnCommandIds(std::string_view commandIds)
+{
+	// CMDS <id> <name> <id> <name> ..., the names are resolved once here
+
+	m_deviceCommandIds.clear();
+	m_deviceCommandNames.clear();
+
+	auto nextToken = [&]() {
+		size_t begin = std::min(commandIds.find_first_not_of(' '), commandIds.size());
+		size_t end = std::min(commandIds.find(' ', begin), commandIds.size());
+		std::string_view token = commandIds.substr(begin, end - begin);
+
+		commandIds.remove_prefix(end);
+
+		return token;
+	};
+
+	for (std::string_view idToken = nextToken(); !idToken.empty(); idToken = nextToken())
+	{
+		std::string_view name = nextToken();
+		uint32_t deviceCommandId;
+
+		if (ParseNumbers(idToken, &deviceCommandId, 1) != 1 || deviceCommandId > CommandTable::s_maxCommands)
+			continue;
+
+		if (deviceCommandId >= m_deviceCommandIds.size())
+		{
+			m_deviceCommandIds.resize(deviceCommandId + 1, CommandTable::s_invalidId);
+			m_deviceCommandNames.resize(deviceCommandId + 1);
+		}
+
+		m_deviceCommandIds[deviceCommandId] = m_commandTable->Find(name);
+		m_deviceCommandNames[deviceCommandId] = name;
+	}
+
+	m_usingCommandIds = true;
+}
+
+void MacroPadDevice::OnCommandTablePublished()
+{
+	// the pending repeats are performed with the table they were parsed with
+
+	if (m_coalesceCommandId != CommandTable::s_invalidId && m_coalescedRepeats > 0)
+		Dispatch(m_coalesceCommandId, m_coalescedRepeats, m_coalesceFirstTime);
+
+	m_coalesceCommandId = CommandTable::s_invalidId;
+	m_coalesceTimer.cancel();
+
+	// the generation is read first, a table published meanwhile is loaded on the next line
+
+	m_commandTableGeneration = m_profileManager.GetGeneration();
+	m_commandTable = m_profileManager.GetActiveTable();
+
+	for (size_t i = 0; i < m_deviceCommandIds.size(); i++)
+		m_deviceCommandIds[i] = m_deviceCommandNames[i].empty() ? CommandTable::s_invalidId : m_commandTable->Find(m_deviceCommandNames[i]);
+}
+
+void MacroPadDevice::ProcessCommand(uint16_t commandId, uint32_t deviceTime, bool hasDeviceTime, LedFrameScheduler::Clock::time_point readTime)
+{
+	auto parsedTime = LedFrameScheduler::Clock::now();
+
+	m_commandsReceived++;
+
+	// latency of the stages before the dispatch
+
+	if (hasDeviceTime && m_hasClockOffset)
+	{
+		int64_t eventTime = (int64_t)UnwrapDeviceTime(deviceTime) + m_clockOffset;
+		int64_t receive = ToMicroseconds(readTime) - eventTime;
+
+		m_latencyStats.receive.Record(receive > 0 ? receive : 0);
+	}
+
+	m_latencyStats.parse.Record(ToMicroseconds(parsedTime) - ToMicroseconds(readTime));
+
+	// a repeat of the key macro of the open window waits for the window to close (knob turns, held keys)
+
+	if (commandId == m_coalesceCommandId)
+	{
+		if (m_coalescedRepeats++ == 0)
+			m_coalesceFirstTime = parsedTime;
+
+		if (m_coalescedRepeats >= s_maxCoalescedRepeats)
+		{
+			Dispatch(commandId, m_coalescedRepeats, m_coalesceFirstTime);
+			m_coalescedRepeats = 0;
+		}
+
+		return;
+	}
+
+	// anything else closes the window and is performed right away
+
+	if (m_coalesceCommandId != CommandTable::s_invalidId && m_coalescedRepeats > 0)
+		Dispatch(m_coalesceCommandId, m_coalescedRepeats, m_coalesceFirstTime);
+
+	m_coalesceCommandId = CommandTable::s_invalidId;
+	m_coalesceTimer.cancel();
+
+	// checked before the dispatch, a profile switch replaces the table the id belongs to
+
+	bool isKeyMacro = m_commandTable->GetAction(commandId).type == KEY_MACRO;
+
+	Dispatch(commandId, 1, parsedTime);
+
+	if (isKeyMacro && m_coalesceWindowMs > 0)
+		StartCoalesceWindow(commandId);
+}
+
+void MacroPadDevice::Dispatch(uint16_t commandId, unsigned int repeatCount, LedFrameScheduler::Clock::time_point parsedTime)
+{
+	// only queued, the executor performs it
+	// a profile switch is published right away and loaded before the next line of the batch (the grace period of the
+	// publish only waits for the readers copying the table pointer), the other devices see it on their next line
+
+	const Action& action = m_commandTable->GetAction(commandId);
+
+	if (action.type == SWITCH_PROFILE)
+	{
+		if (m_profileManager.SwitchProfile(action.profileName) && m_profileManager.GetGeneration() != m_commandTableGeneration)
+			OnCommandTablePublished();
+	}
+	else
+		m_actionExecutor.Submit(m_commandTable, commandId, repeatCount);
+
+	m_actionsDispatched++;
+	m_latencyStats.dispatch.Record(ToMicroseconds(LedFrameScheduler::Clock::now()) - ToMicroseconds(parsedTime));
+}
+
+void MacroPadDevice::StartCoalesceWindow(uint16_t commandId)
+{
+	m_coalesceCommandId = commandId;
+	m_coalescedRepeats = 0;
+
+	m_coalesceTimer.expires_after(std::chrono::milliseconds(m_coalesceWindowMs));
+	m_coalesceTimer.async_wait([self = shared_from_this()](const asio::error_code& error) {
+		if (!error)
+			self->OnCoalesceTimer();
+	});
+}
+
+void MacroPadDevice::OnCoalesceTimer()
+{
+	if (m_coalesceCommandId == CommandTable::s_invalidId)
+		return;
+
+	// the repeats of the window are performed together, while they keep coming another window is opened
+
+	if (m_coalescedRepeats == 0)
+	{
+		m_coalesceCommandId = CommandTable::s_invalidId;
+		return;
+	}
+
+	uint16_t commandId = m_coalesceCommandId;
+
+	Dispatch(commandId, m_coalescedRepeats, m_coalesceFirstTime);
+	StartCoalesceWindow(commandId);
+}
+
+void MacroPadDevice::TrySend()
+{
+	if (m_sending || !m_port.is_open())
+		return;
+
+	// control frames go first and aren't paced
+
+	if (!m_controlFrames.empty())
+	{
+		m_controlFrameInFlight = std::move(m_controlFrames.front());
+		m_controlFrames.pop_front();
+
+		// start of the round trip used for the clock offset
+
+		if (m_controlFrameInFlight[3] == (uint8_t)LedFrameType::Hello)
+		{
+			m_helloSequence = m_controlFrameInFlight[6];
+			m_helloSendTime = LedFrameScheduler::Clock::now();
+		}
+
+		m_sending = true;
+
+		asio::async_write(m_port, asio::buffer(m_controlFrameInFlight),
+			[self = shared_from_this()](const asio::error_code& error, size_t bytesWritten) {
+				return self->OnWriteProgress(error, bytesWritten);
+			},
+			[self = shared_from_this()](const asio::error_code& error, size_t bytesWritten) {
+				self->OnWriteDone(bytesWritten);
+				self->m_sending = false;
+
+				if (!error)
+					self->TrySend();
+			});
+
+		return;
+	}
+
+	// only the newest frame is sent, the ones published while the link was busy are dropped
+
+	if (!m_ledsTripleBuffer.Consume())
+		return;
+
+	const std::vector<uint8_t>& leds = m_ledsTripleBuffer.GetReadBuffer();
+	const LedFrame& frame = m_frameEncoder.Encode(leds.data(), leds.size(), m_frameScheduler.NextEncoding());
+
+	// the payload points into the read buffer of the triple buffer or the encoder, both stay untouched until
+	// the next TrySend, which can't happen before this write completes
+
+	std::array<asio::const_buffer, 3> buffers = {
+		asio::buffer(frame.header),
+		asio::buffer(frame.payload, frame.payloadSize),
+		asio::buffer(frame.trailer)
+	};
+
+	if (!m_gatherWrites)
+	{
+		frame.CopyTo(m_contiguousLedFrame);
+		buffers = { asio::buffer(m_contiguousLedFrame), asio::const_buffer(), asio::const_buffer() };
+	}
+
+	m_sending = true;
+	m_unackedFrames++;
+
+	auto writeStart = LedFrameScheduler::Clock::now();
+
+	asio::async_write(m_port, buffers,
+		[self = shared_from_this()](const asio::error_code& error, size_t bytesWritten) {
+			return self->OnWriteProgress(error, bytesWritten);
+		},
+		[self = shared_from_this(), writeStart](const asio::error_code& error, size_t bytesWritten) {
+			self->OnWriteDone(bytesWritten);
+
+			if (error)
+			{
+				self->m_sending = false;
+				return;
+			}
+
+			self->m_framesWritten++;
+
+			// give the link time to drain the frame before sending the next one
+
+			auto wait = self->m_frameScheduler.OnFrameSent(bytesWritten, LedFrameScheduler::Clock::now() - writeStart);
+
+			self->m_pacingTimer.expires_after(wait);
+			self->m_pacingTimer.async_wait([self](const asio::error_code& error) {
+				self->m_sending = false;
+
+				if (!error)
+					self->TrySend();
+			});
+		});
+}
+
+void MacroPadDevice::SendControlFrame(LedFrameType type, const void* payload, size_t size)
+{
+	// control frames are tiny and queued, so they are copied into one buffer
+
+	m_controlFrameBuilder.Build(type, payload, size).CopyTo(m_controlFrames.emplace_back());
+
+	TrySend();
+}
+
+size_t MacroPadDevice::OnWriteProgress(const asio::error_code& error, size_t bytesWritten)
+{
+	// called before every write call with the bytes written so far, so the difference is what the previous
+	// call wrote (the call after the last write is skipped when everything was written)
+
+	size_t written = bytesWritten - m_writeAccounted;
+
+	if (written > 0)
+	{
+		m_bytesWritten += written;
+		m_usbPackets += (written + s_usbPacketSize - 1) / s_usbPacketSize;
+		m_writeAccounted = bytesWritten;
+	}
+
+	if (error)
+		return 0;
+
+	m_writeCalls++;
+
+	return asio::detail::default_max_transfer_size;
+}
+
+void MacroPadDevice::OnWriteDone(size_t bytesWritten)
+{
+	// account the last write call, the error only stops the count of a new call
+
+	OnWriteProgress(asio::error::operation_aborted, bytesWritten);
+
+	m_writeAccounted = 0;
+	m_writesCompleted++;
+}
+
+void MacroPadDevice::OnCapabilities(uint32_t numLeds, uint32_t frameTypes, uint32_t maxBaudRate)
+{
+	m_deviceNumLeds = numLeds;
+	m_deviceFrameTypes = frameTypes;
+	m_deviceMaxBaudRate = maxBaudRate;
+	m_frameEncoder.SetSupportedFrameTypes(frameTypes);
+
+	// the device sends its commands as short ids once it has told us their names
+
+	if ((frameTypes & (1u << (int)LedFrameType::CommandIds)) && !m_usingCommandIds)
+		SendControlFrame(LedFrameType::CommandIds, nullptr, 0);
+
+	// fastest rate both sides support that hasn't failed before
+
+	if (m_requestedBaudRate != 0)
+		return;
+
+	unsigned int maxRate = std::min(m_maxBaudRate, (unsigned int)maxBaudRate);
+
+	for (unsigned int baudRate : g_baudRates)
+	{
+		if (baudRate > maxRate || std::find(m_failedBaudRates.begin(), m_failedBaudRates.end(), baudRate) != m_failedBaudRates.end())
+			continue;
+
+		if (baudRate > m_baudRate)
+		{
+			uint8_t payload[4] = { (uint8_t)(baudRate & 0xFF), (uint8_t)((baudRate >> 8) & 0xFF), (uint8_t)((baudRate >> 16) & 0xFF), (uint8_t)(baudRate >> 24) };
+
+			m_requestedBaudRate = baudRate;
+			m_baudRequestTime = LedFrameScheduler::Clock::now();
+			SendControlFrame(LedFrameType::SetBaud, payload, sizeof(payload));
+		}
+
+		break;
+	}
+}
+
+void MacroPadDevice::OnClockSample(uint32_t deviceTime, LedFrameScheduler::Clock::time_point receiveTime)
+{
+	// the arduino time is taken half way through the round trip, the sample with the shortest round trip is the most precise
+
+	int64_t roundTrip = ToMicroseconds(receiveTime) - ToMicroseconds(m_helloSendTime);
+
+	if (roundTrip < 0)
+		return;
+
+	m_clockOffsetRoundTrip += m_clockOffsetRoundTrip / 16;
+
+	if (!m_hasClockOffset || roundTrip <= m_clockOffsetRoundTrip)
+	{
+		m_clockOffset = ToMicroseconds(m_helloSendTime) + roundTrip / 2 - (int64_t)UnwrapDeviceTime(deviceTime);
+		m_clockOffsetRoundTrip = roundTrip;
+		m_hasClockOffset = true;
+	}
+}
+
+uint64_t MacroPadDevice::UnwrapDeviceTime(uint32_t deviceTime)
+{
+	// the lines arrive in order, a big jump backwards is a wrap
+
+	if (deviceTime < m_lastDeviceTime && m_lastDeviceTime - deviceTime > 0x80000000u)
+		m_deviceTimeWraps++;
+
+	m_lastDeviceTime = deviceTime;
+
+	return (m_deviceTimeWraps << 32) | deviceTime;
+}
+
+void MacroPadDevice::SetPortBaudRate(unsigned int baudRate)
+{
+	asio::error_code error;
+	m_port.set_option(asio::serial_port_base::baud_rate(baudRate), error);
+
+	if (error)
+	{
+		std::cerr << "Error: " << m_portName << " can't use " << baudRate << " baud: " << error.message() << std::endl;
+		return;
+	}
+
+	// frames in flight at the old rate are lost, start again from a keyframe
+
+	m_baudRate = baudRate;
+	m_frameScheduler.SetBaudRate(baudRate);
+	m_frameEncoder.Reset();
+	m_lastReceiveTime = LedFrameScheduler::Clock::now();
+	m_unackedFrames = 0;
+
+	std::cout << "[INFO] " << m_portName << " running at " << baudRate << " baud" << std::endl;
+}
+
+void MacroPadDevice::StartLinkTimer()
+{
+	m_linkTimer.expires_after(g_linkCheckInterval);
+	m_linkTimer.async_wait([self = shared_from_this()](const asio::error_code& error) {
+		if (!error)
+			self->OnLinkTimer();
+	});
+}
+
+void MacroPadDevice::OnLinkTimer()
+{
+	if (!m_port.is_open())
+		return;
+
+	// the negotiated rate stopped working (no answers or no acknowledged frames), the arduino
+	// falls back on its own when it stops receiving valid frames so both end up at the base rate
+
+	auto now = LedFrameScheduler::Clock::now();
+
+	// frame rates since the last check
+
+	float fpsSeconds = std::chrono::duration<float>(now - m_fpsTime).count();
+
+	if (fpsSeconds > 0.0f)
+	{
+		m_writtenFps = m_framesWritten / fpsSeconds;
+		m_acknowledgedFps = m_framesAcknowledged / fpsSeconds;
+	}
+
+	m_fpsTime = now;
+	m_framesWritten = 0;
+	m_framesAcknowledged = 0;
+
+	if (m_baudRate != m_baseBaudRate && (now - m_lastReceiveTime > g_linkTimeout || m_unackedFrames > g_maxUnackedFrames))
+	{
+		std::cerr << "[WARNING] " << m_portName << " link errors at " << m_baudRate << " baud, falling back" << std::endl;
+
+		m_failedBaudRates.push_back(m_baudRate);
+		SetPortBaudRate(m_baseBaudRate);
+	}
+
+	// a switch that wasn't confirmed in time can be requested again (one still in flight is left alone)
+
+	if (m_requestedBaudRate != 0 && now - m_baudRequestTime > g_baudRequestTimeout)
+		m_requestedBaudRate = 0;
+
+	// hello doubles as keep alive and asks again for the capabilities (they trigger the negotiation)
+
+	SendControlFrame(LedFrameType::Hello, nullptr, 0);
+
+	StartLinkTimer();
+}
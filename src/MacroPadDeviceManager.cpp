@@ -0,0 +1,71 @@
+#include "MacroPadDeviceManager.h"
+#include <algorithm>
+
+/* MACRO PAD DEVICE MANAGER */
+
+MacroPadDeviceManager::MacroPadDeviceManager(int threadsCount)
+	: m_actionExecutor(CreatePlatformInputInjector(), CreatePlatformProcessLauncher(m_io))
+{
+	// keep the io running even when no device has pending operations
+
+	m_workGuard.emplace(asio::make_work_guard(m_io));
+
+	for (int i = 0; i < threadsCount; i++)
+	{
+		m_threads.push_back(std::thread([this]() {
+			m_io.run();
+		}));
+	}
+}
+
+MacroPadDeviceManager::~MacroPadDeviceManager()
+{
+	RemoveAllDevices();
+	m_actionExecutor.GetProcessLauncher().Stop();
+
+	// let the io finish the pending handlers and wait for the threads
+
+	m_workGuard.reset();
+
+	for (auto& thread : m_threads)
+		thread.join();
+}
+
+std::shared_ptr<MacroPadDevice> MacroPadDeviceManager::AddDevice(const std::string& portName, unsigned int baudRate)
+{
+	auto device = std::make_shared<MacroPadDevice>(m_io, portName, baudRate, m_profileManager, m_actionExecutor);
+
+	if (!device->Open())
+		return nullptr;
+
+	m_devices.push_back(device);
+
+	return device;
+}
+
+void MacroPadDeviceManager::RemoveDevice(const std::string& portName)
+{
+	auto it = std::find_if(m_devices.begin(), m_devices.end(), [&](const std::shared_ptr<MacroPadDevice>& device) {
+		return device->GetPortName() == portName;
+	});
+
+	if (it != m_devices.end())
+	{
+		(*it)->Close();
+		m_devices.erase(it);
+	}
+}
+
+void MacroPadDeviceManager::RemoveAllDevices()
+{
+	for (auto& device : m_devices)
+		device->Close();
+
+	m_devices.clear();
+}
+
+void MacroPadDeviceManager::PublishLeds(const uint8_t* leds, size_t size)
+{
+	for (auto& device : m_devices)
+		device->PublishLeds(leds, size);
+}
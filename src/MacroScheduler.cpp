@@ -0,0 +1,148 @@
+#include "MacroScheduler.h"
+
+/* MACRO SCHEDULER */
+
+MacroScheduler::MacroScheduler(InjectCallback injectCallback)
+	: m_injectCallback(std::move(injectCallback)), m_epoch(Clock::now()), m_runningMacros(0), m_stopping(false)
+{
+	m_thread = std::thread(&MacroScheduler::Run, this);
+}
+
+MacroScheduler::~MacroScheduler()
+{
+	// the running macros are dropped
+
+	{
+		std::scoped_lock lock(m_mutex);
+		m_stopping = true;
+	}
+
+	m_condition.notify_one();
+	m_thread.join();
+}
+
+void MacroScheduler::Start(std::shared_ptr<const CommandTable> commandTable, uint16_t commandId, unsigned int repeatCount)
+{
+	const TimedMacro* timedMacro = commandTable->GetTimedMacro(commandId);
+
+	if (!timedMacro || timedMacro->GetBatches().empty() || repeatCount == 0)
+		return;
+
+	// the start time is taken here so the time it takes the thread to wake up counts as jitter, it's moved to the next
+	// tick so every batch is due on a tick (otherwise all of them would be up to a tick late)
+
+	Clock::time_point startTime = m_epoch + std::chrono::milliseconds(GetTick(Clock::now()));
+	Macro macro = { std::move(commandTable), timedMacro, startTime, repeatCount, 0 };
+
+	{
+		std::scoped_lock lock(m_mutex);
+		m_startedMacros.push_back(std::move(macro));
+	}
+
+	m_runningMacros.fetch_add(1, std::memory_order_relaxed);
+	m_condition.notify_one();
+}
+
+void MacroScheduler::Run()
+{
+	std::vector<Macro> startedMacros;
+	std::unique_lock lock(m_mutex);
+
+	while (!m_stopping)
+	{
+		startedMacros.swap(m_startedMacros);
+		lock.unlock();
+
+		// schedule the first batch of the started macros
+
+		for (Macro& macro : startedMacros)
+		{
+			uint32_t macroIndex;
+
+			if (!m_freeMacros.empty())
+			{
+				macroIndex = m_freeMacros.back();
+				m_freeMacros.pop_back();
+				m_macros[macroIndex] = std::move(macro);
+			}
+			else
+			{
+				macroIndex = (uint32_t)m_macros.size();
+				m_macros.push_back(std::move(macro));
+			}
+
+			ScheduleNextBatch(macroIndex);
+		}
+
+		startedMacros.clear();
+
+		// fire what is due (a tick is due once it has fully started)
+
+		uint64_t currentTick = (uint64_t)std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - m_epoch).count();
+
+		m_timerWheel.Advance(currentTick, [this](uint32_t macroIndex) { OnTimer(macroIndex); });
+
+		// sleep until the next timer or a new macro
+
+		uint64_t nextTick = m_timerWheel.GetNextExpiry();
+
+		lock.lock();
+
+		auto wakeUp = [this]() { return !m_startedMacros.empty() || m_stopping; };
+
+		if (nextTick == TimerWheel::s_noExpiry)
+			m_condition.wait(lock, wakeUp);
+		else if (nextTick > currentTick)
+			m_condition.wait_until(lock, m_epoch + std::chrono::milliseconds(nextTick), wakeUp);
+	}
+}
+
+void MacroScheduler::ScheduleNextBatch(uint32_t macroIndex)
+{
+	const Macro& macro = m_macros[macroIndex];
+	const TimedMacro::Batch& batch = macro.timedMacro->GetBatches()[macro.nextBatch];
+
+	m_timerWheel.Schedule(GetTick(macro.startTime + std::chrono::milliseconds(batch.timeMs)), macroIndex);
+}
+
+void MacroScheduler::OnTimer(uint32_t macroIndex)
+{
+	Macro& macro = m_macros[macroIndex];
+	const std::vector<TimedMacro::Batch>& batches = macro.timedMacro->GetBatches();
+	const TimedMacro::Batch& batch = batches[macro.nextBatch];
+
+	Clock::time_point dueTime = macro.startTime + std::chrono::milliseconds(batch.timeMs);
+	Clock::time_point now = Clock::now();
+
+	m_injectCallback(macro.commandTable, *batch.sequence);
+	m_jitter.Record(now > dueTime ? std::chrono::duration_cast<std::chrono::microseconds>(now - dueTime).count() : 0);
+
+	// next batch, next repeat or done
+
+	if (++macro.nextBatch == batches.size())
+	{
+		if (--macro.repeatsLeft == 0)
+		{
+			macro.commandTable.reset();
+			m_freeMacros.push_back(macroIndex);
+			m_runningMacros.fetch_sub(1, std::memory_order_relaxed);
+			return;
+		}
+
+		macro.startTime += std::chrono::milliseconds(macro.timedMacro->GetDuration());
+		macro.nextBatch = 0;
+	}
+
+	ScheduleNextBatch(macroIndex);
+}
+
+uint64_t MacroScheduler::GetTick(Clock::time_point time) const
+{
+	auto elapsed = time - m_epoch;
+	auto milliseconds = std::chrono::duration_cast<std::chrono::milliseconds>(elapsed);
+
+	if (milliseconds < elapsed)
+		milliseconds += std::chrono::milliseconds(1);
+
+	return (uint64_t)milliseconds.count();
+}
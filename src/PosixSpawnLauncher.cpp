@@ -0,0 +1,209 @@
+#ifndef _WIN32
+
+#include "PosixSpawnLauncher.h"
+#include <spawn.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+#include <iostream>
+
+extern char** environ;
+
+class PosixSpawnProcess : public PreparedProcess
+{
+public:
+	PosixSpawnProcess(std::string path, std::string executable, std::vector<std::string> arguments)
+		: PreparedProcess(std::move(path)), m_executable(std::move(executable)), m_arguments(std::move(arguments))
+	{
+		for (std::string& argument : m_arguments)
+			m_argv.push_back(argument.data());
+
+		m_argv.push_back(nullptr);
+	}
+
+	const char* GetExecutable() const { return m_executable.c_str(); }
+	char* const* GetArgv() const { return m_argv.data(); }
+
+private:
+	std::string m_executable;
+	std::vector<std::string> m_arguments;
+	std::vector<char*> m_argv; // points into the arguments
+};
+
+// split a command line in arguments, double quotes group spaces
+
+static std::vector<std::string> SplitCommandLine(const std::string& commandLine)
+{
+	std::vector<std::string> arguments;
+	std::string argument;
+	bool quoted = false;
+	bool hasArgument = false;
+
+	for (char c : commandLine)
+	{
+		if (c == '"')
+		{
+			quoted = !quoted;
+			hasArgument = true;
+		}
+		else if (c == ' ' && !quoted)
+		{
+			if (hasArgument)
+				arguments.push_back(std::move(argument));
+
+			argument.clear();
+			hasArgument = false;
+		}
+		else
+		{
+			argument += c;
+			hasArgument = true;
+		}
+	}
+
+	if (hasArgument)
+		arguments.push_back(std::move(argument));
+
+	return arguments;
+}
+
+// full path of the executable (searched in the PATH if it has no slash), empty if it isn't found
+
+static std::string ResolveExecutable(const std::string& name)
+{
+	if (name.find('/') != std::string::npos)
+		return access(name.c_str(), X_OK) == 0 ? name : std::string();
+
+	const char* pathVariable = std::getenv("PATH");
+	std::string searchPath = pathVariable ? pathVariable : "/usr/local/bin:/usr/bin:/bin";
+	size_t start = 0;
+
+	while (start <= searchPath.size())
+	{
+		size_t end = std::min(searchPath.find(':', start), searchPath.size());
+		std::string directory = searchPath.substr(start, end - start);
+		std::string candidate = (directory.empty() ? "." : directory) + "/" + name;
+
+		if (access(candidate.c_str(), X_OK) == 0)
+			return candidate;
+
+		start = end + 1;
+	}
+
+	return std::string();
+}
+
+/* POSIX SPAWN LAUNCHER */
+
+PosixSpawnLauncher::PosixSpawnLauncher(asio::io_context& io)
+	: m_strand(asio::make_strand(io)), m_childSignal(m_strand, SIGCHLD)
+{
+	StartReaping();
+}
+
+std::shared_ptr<const PreparedProcess> PosixSpawnLauncher::Prepare(const std::string& path) const
+{
+	std::vector<std::string> arguments = SplitCommandLine(path);
+
+	if (arguments.empty())
+		return nullptr;
+
+	std::string executable = ResolveExecutable(arguments[0]);
+
+	if (executable.empty())
+	{
+		std::cerr << "[WARNING] Process: " << arguments[0] << " not found, it won't be launched" << std::endl;
+		return nullptr;
+	}
+
+	return std::make_shared<const PosixSpawnProcess>(path, std::move(executable), std::move(arguments));
+}
+
+bool PosixSpawnLauncher::Launch(const PreparedProcess& preparedProcess)
+{
+	const PosixSpawnProcess& process = static_cast<const PosixSpawnProcess&>(preparedProcess);
+
+	// the child gets its own process group so a ctrl+c on the controller doesn't reach it
+
+	posix_spawnattr_t attributes;
+	posix_spawnattr_init(&attributes);
+
+	short flags = POSIX_SPAWN_SETPGROUP | POSIX_SPAWN_SETSIGMASK;
+#ifdef POSIX_SPAWN_USEVFORK
+	flags |= POSIX_SPAWN_USEVFORK;
+#endif
+
+	sigset_t signalMask;
+	sigemptyset(&signalMask);
+
+	posix_spawnattr_setflags(&attributes, flags);
+	posix_spawnattr_setpgroup(&attributes, 0);
+	posix_spawnattr_setsigmask(&attributes, &signalMask);
+
+	pid_t pid;
+	int result;
+
+	{
+		std::scoped_lock lock(m_childrenMutex);
+
+		result = posix_spawn(&pid, process.GetExecutable(), nullptr, &attributes, process.GetArgv(), environ);
+
+		if (result == 0)
+			m_children.push_back(pid);
+	}
+
+	posix_spawnattr_destroy(&attributes);
+
+	if (result != 0)
+	{
+		std::cout << "Process: " << process.GetPath() << " couldn't be opened (" << std::strerror(result) << ")" << std::endl;
+		return false;
+	}
+
+	std::cout << "Process: " << process.GetPath() << " opened succesfully" << std::endl;
+
+	return true;
+}
+
+void PosixSpawnLauncher::Stop()
+{
+	asio::post(m_strand, [this]() {
+		asio::error_code error;
+		m_childSignal.cancel(error);
+	});
+}
+
+size_t PosixSpawnLauncher::GetRunningChildren() const
+{
+	std::scoped_lock lock(m_childrenMutex);
+
+	return m_children.size();
+}
+
+void PosixSpawnLauncher::StartReaping()
+{
+	m_childSignal.async_wait([this](const asio::error_code& error, int) {
+		if (error)
+			return;
+
+		ReapChildren();
+		StartReaping();
+	});
+}
+
+void PosixSpawnLauncher::ReapChildren()
+{
+	// only our children are waited for, several may have exited for one signal
+
+	std::scoped_lock lock(m_childrenMutex);
+
+	m_children.erase(std::remove_if(m_children.begin(), m_children.end(), [](pid_t pid) {
+		int status;
+		return waitpid(pid, &status, WNOHANG) != 0;
+	}), m_children.end());
+}
+
+#endif
@@ -0,0 +1,14 @@
+#include "ProcessLauncher.h"
+#include "CreateProcessLauncher.h"
+#include "PosixSpawnLauncher.h"
+
+/* PROCESS LAUNCHER */
+
+std::unique_ptr<ProcessLauncher> CreatePlatformProcessLauncher(asio::io_context& io)
+{
+#ifdef _WIN32
+	return std::make_unique<CreateProcessLauncher>();
+#else
+	return std::make_unique<PosixSpawnLauncher>(io);
+#endif
+}
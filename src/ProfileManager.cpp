@@ -0,0 +1,69 @@
+#include "ProfileManager.h"
+#include <algorithm>
+#include <iostream>
+
+/* PROFILE MANAGER */
+
+ProfileManager::ProfileManager()
+	: m_activeProfile(0), m_switchCount(0), m_activeTable(std::make_shared<const CommandTable>())
+{
+}
+
+void ProfileManager::SetProfiles(std::vector<Profile> profiles)
+{
+	std::scoped_lock lock(m_mutex);
+
+	std::string activeName = m_activeProfile < m_profiles.size() ? m_profiles[m_activeProfile].name : std::string();
+
+	m_profiles = std::move(profiles);
+
+	auto it = std::find_if(m_profiles.begin(), m_profiles.end(), [&](const Profile& profile) { return profile.name == activeName; });
+
+	Activate(it != m_profiles.end() ? it - m_profiles.begin() : 0);
+}
+
+bool ProfileManager::SwitchProfile(std::string_view name)
+{
+	std::scoped_lock lock(m_mutex);
+
+	auto it = std::find_if(m_profiles.begin(), m_profiles.end(), [&](const Profile& profile) { return profile.name == name; });
+
+	if (it == m_profiles.end())
+	{
+		std::cerr << "[WARNING] There is no profile " << name << std::endl;
+		return false;
+	}
+
+	if ((size_t)(it - m_profiles.begin()) != m_activeProfile)
+	{
+		Activate(it - m_profiles.begin());
+		m_switchCount.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	return true;
+}
+
+std::string ProfileManager::GetActiveProfile() const
+{
+	std::scoped_lock lock(m_mutex);
+
+	return m_activeProfile < m_profiles.size() ? m_profiles[m_activeProfile].name : std::string();
+}
+
+std::vector<std::string> ProfileManager::GetProfileNames() const
+{
+	std::scoped_lock lock(m_mutex);
+
+	std::vector<std::string> names;
+
+	for (const Profile& profile : m_profiles)
+		names.push_back(profile.name);
+
+	return names;
+}
+
+void ProfileManager::Activate(size_t profile)
+{
+	m_activeProfile = profile;
+	m_activeTable.Publish(profile < m_profiles.size() ? m_profiles[profile].commandTable : std::make_shared<const CommandTable>());
+}
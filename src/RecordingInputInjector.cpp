@@ -0,0 +1,42 @@
+#include "RecordingInputInjector.h"
+
+/* RECORDING INPUT INJECTOR */
+
+std::shared_ptr<const InputSequence> RecordingInputInjector::Compile(std::vector<InputEvent> events) const
+{
+	return std::make_shared<const InputSequence>(std::move(events));
+}
+
+void RecordingInputInjector::Inject(const InputSequence& sequence, unsigned int repeatCount)
+{
+	const std::vector<InputEvent>& events = sequence.GetEvents();
+
+	std::scoped_lock lock(m_mutex);
+
+	for (unsigned int repeat = 0; repeat < repeatCount; repeat++)
+		m_events.insert(m_events.end(), events.begin(), events.end());
+
+	m_injectCalls++;
+}
+
+std::vector<InputEvent> RecordingInputInjector::GetEvents() const
+{
+	std::scoped_lock lock(m_mutex);
+
+	return m_events;
+}
+
+size_t RecordingInputInjector::GetInjectCalls() const
+{
+	std::scoped_lock lock(m_mutex);
+
+	return m_injectCalls;
+}
+
+void RecordingInputInjector::Clear()
+{
+	std::scoped_lock lock(m_mutex);
+
+	m_events.clear();
+	m_injectCalls = 0;
+}
@@ -0,0 +1,173 @@
+#include "ScriptWorker.h"
+#include "LuaScriptCache.h"
+#include <iostream>
+
+extern "C"
+{
+#include <lua.h>
+#include <lualib.h>
+#include <lauxlib.h>
+}
+
+static uint64_t MicrosecondsBetween(ScriptWorker::Clock::time_point begin, ScriptWorker::Clock::time_point end)
+{
+	return std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count();
+}
+
+/* SCRIPT WORKER */
+
+ScriptWorker::ScriptWorker(SetupCallback setupCallback)
+	: m_setupCallback(std::move(setupCallback)), m_jobs(s_queueCapacity), m_signal(0), m_stopping(false), m_droppedCallbacks(0), m_script(nullptr)
+{
+	m_thread = std::thread(&ScriptWorker::Run, this);
+}
+
+ScriptWorker::~ScriptWorker()
+{
+	// the queued callbacks are dropped
+
+	m_stopping = true;
+	m_signal.fetch_add(1, std::memory_order_release);
+	m_signal.notify_one();
+
+	m_thread.join();
+}
+
+bool ScriptWorker::LoadScript(const std::string& path)
+{
+	Job job;
+	job.scriptPath = path;
+
+	return Push(std::move(job));
+}
+
+bool ScriptWorker::Submit(std::shared_ptr<const CommandTable> commandTable, uint16_t commandId, unsigned int repeatCount)
+{
+	Job job;
+	job.commandTable = std::move(commandTable);
+	job.commandId = commandId;
+	job.repeatCount = repeatCount;
+	job.submitTime = Clock::now();
+
+	return Push(std::move(job));
+}
+
+bool ScriptWorker::Push(Job job)
+{
+	if (!m_jobs.TryPush(std::move(job)))
+	{
+		m_droppedCallbacks.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+
+	m_signal.fetch_add(1, std::memory_order_release);
+	m_signal.notify_one();
+
+	return true;
+}
+
+void ScriptWorker::ForEachCallbackStats(const std::function<void(const std::string& function, const LatencyHistogram& execution)>& callback) const
+{
+	std::scoped_lock lock(m_callbackStatsMutex);
+
+	for (const auto& [function, execution] : m_callbackStats)
+		callback(function, execution);
+}
+
+void ScriptWorker::ResetStats()
+{
+	m_queueStats.Reset();
+
+	std::scoped_lock lock(m_callbackStatsMutex);
+
+	for (auto& [function, execution] : m_callbackStats)
+		execution.Reset();
+}
+
+void ScriptWorker::Run()
+{
+	Job job;
+
+	while (!m_stopping)
+	{
+		// the signal is read before trying the queue so a push in between wakes the wait up
+
+		uint32_t signal = m_signal.load(std::memory_order_acquire);
+
+		if (!m_jobs.TryPop(job))
+		{
+			m_signal.wait(signal, std::memory_order_acquire);
+			continue;
+		}
+
+		if (job.commandTable)
+			Call(job);
+		else
+			Load(job.scriptPath);
+
+		job = Job();
+	}
+
+	if (m_script)
+		lua_close(m_script);
+}
+
+void ScriptWorker::Load(const std::string& path)
+{
+	if (m_script)
+		lua_close(m_script);
+
+	m_script = luaL_newstate();
+	luaL_openlibs(m_script);
+
+	if (m_setupCallback)
+		m_setupCallback(m_script);
+
+	if (LuaScriptCache::DoFile(m_script, path) != LUA_OK)
+	{
+		std::cerr << "[WARNING] The callbacks script " << path << " couldn't be loaded: " << lua_tostring(m_script, -1) << std::endl;
+		lua_pop(m_script, 1);
+	}
+}
+
+void ScriptWorker::Call(const Job& job)
+{
+	Clock::time_point startTime = Clock::now();
+
+	m_queueStats.Record(MicrosecondsBetween(job.submitTime, startTime));
+
+	const std::string& function = job.commandTable->GetAction(job.commandId).luaFunction;
+
+	if (!m_script)
+	{
+		std::cerr << "[WARNING] No callbacks script is loaded for " << function << std::endl;
+		return;
+	}
+
+	if (lua_getglobal(m_script, function.c_str()) != LUA_TFUNCTION)
+	{
+		std::cerr << "[WARNING] The lua callback " << function << " isn't a function" << std::endl;
+		lua_pop(m_script, 1);
+		return;
+	}
+
+	std::string_view name = job.commandTable->GetName(job.commandId);
+
+	lua_pushlstring(m_script, name.data(), name.size());
+	lua_pushinteger(m_script, job.repeatCount);
+
+	if (lua_pcall(m_script, 2, 0, 0) != LUA_OK)
+	{
+		std::cerr << "[WARNING] The lua callback " << function << " failed: " << lua_tostring(m_script, -1) << std::endl;
+		lua_pop(m_script, 1);
+	}
+
+	GetCallbackStats(function).Record(MicrosecondsBetween(startTime, Clock::now()));
+}
+
+LatencyHistogram& ScriptWorker::GetCallbackStats(const std::string& function)
+{
+	std::scoped_lock lock(m_callbackStatsMutex);
+
+	return m_callbackStats.try_emplace(function).first->second;
+}
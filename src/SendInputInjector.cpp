@@ -0,0 +1,59 @@
+#ifdef _WIN32
+
+#include "SendInputInjector.h"
+#include <Windows.h>
+#include <algorithm>
+
+class SendInputSequence : public InputSequence
+{
+public:
+	explicit SendInputSequence(std::vector<InputEvent> events)
+		: InputSequence(std::move(events))
+	{
+		const std::vector<InputEvent>& sequenceEvents = GetEvents();
+
+		m_inputs.resize(sequenceEvents.size() * InputInjector::s_maxBatchedRepeats);
+		ZeroMemory(m_inputs.data(), m_inputs.size() * sizeof(INPUT));
+
+		for (size_t i = 0; i < m_inputs.size(); i++)
+		{
+			const InputEvent& event = sequenceEvents[i % sequenceEvents.size()];
+
+			m_inputs[i].type = INPUT_KEYBOARD;
+			m_inputs[i].ki.wVk = event.key;
+			m_inputs[i].ki.dwFlags = event.release ? KEYEVENTF_KEYUP : 0;
+		}
+	}
+
+	const std::vector<INPUT>& GetInputs() const { return m_inputs; }
+
+private:
+	std::vector<INPUT> m_inputs;
+};
+
+/* SENDINPUT INJECTOR */
+
+std::shared_ptr<const InputSequence> SendInputInjector::Compile(std::vector<InputEvent> events) const
+{
+	return std::make_shared<const SendInputSequence>(std::move(events));
+}
+
+void SendInputInjector::Inject(const InputSequence& sequence, unsigned int repeatCount)
+{
+	const std::vector<INPUT>& inputs = static_cast<const SendInputSequence&>(sequence).GetInputs();
+	size_t numEvents = sequence.GetEvents().size();
+
+	if (numEvents == 0)
+		return;
+
+	while (repeatCount > 0)
+	{
+		unsigned int batch = std::min(repeatCount, s_maxBatchedRepeats);
+
+		SendInput((UINT)(numEvents * batch), (LPINPUT)inputs.data(), sizeof(INPUT));
+
+		repeatCount -= batch;
+	}
+}
+
+#endif
@@ -0,0 +1,183 @@
+#include "TimedMacro.h"
+#include <algorithm>
+#include <iostream>
+
+static constexpr unsigned char s_shiftKey = 0x10;
+
+// events with their time, built step by step
+
+struct Timeline
+{
+	struct TimedEvent
+	{
+		uint32_t timeMs;
+		InputEvent event;
+	};
+
+	std::vector<TimedEvent> events;
+	uint32_t timeMs = 0;
+	bool truncated = false;
+	bool down[256] = {};
+
+	void Add(unsigned char key, bool release)
+	{
+		if (events.size() >= TimedMacro::s_maxEvents)
+		{
+			truncated = true;
+			return;
+		}
+
+		events.push_back(TimedEvent{ timeMs, InputEvent{ key, release } });
+		down[key] = !release;
+	}
+
+	void Wait(uint32_t milliseconds)
+	{
+		timeMs = (uint32_t)std::min<uint64_t>((uint64_t)timeMs + milliseconds, UINT32_MAX);
+	}
+
+	void AddSteps(const std::vector<MacroStep>& steps)
+	{
+		for (const MacroStep& step : steps)
+		{
+			if (truncated)
+				return;
+
+			switch (step.type)
+			{
+			case MacroStepType::PRESS:
+				Add(step.key, false);
+				break;
+			case MacroStepType::RELEASE:
+				Add(step.key, true);
+				break;
+			case MacroStepType::TAP:
+				Add(step.key, false);
+				Add(step.key, true);
+				break;
+			case MacroStepType::HOLD:
+				Add(step.key, false);
+				Wait(step.milliseconds);
+				Add(step.key, true);
+				break;
+			case MacroStepType::DELAY:
+				Wait(step.milliseconds);
+				break;
+			case MacroStepType::TEXT:
+				AddText(step.text, step.milliseconds);
+				break;
+			case MacroStepType::REPEAT:
+				for (uint32_t i = 0; i < step.count && !truncated; i++)
+					AddSteps(step.steps);
+				break;
+			}
+		}
+	}
+
+	void AddText(const std::string& text, uint32_t milliseconds)
+	{
+		for (size_t i = 0; i < text.size(); i++)
+		{
+			unsigned char key;
+			bool shift;
+
+			if (!TimedMacro::GetCharacterKey(text[i], key, shift))
+			{
+				std::cerr << "[WARNING] The character '" << text[i] << "' can't be typed" << std::endl;
+				continue;
+			}
+
+			// shift only around the character so the other keys of the macro aren't affected
+
+			bool shiftDown = down[s_shiftKey];
+
+			if (shift && !shiftDown)
+				Add(s_shiftKey, false);
+
+			Add(key, false);
+			Add(key, true);
+
+			if (shift && !shiftDown)
+				Add(s_shiftKey, true);
+
+			if (i + 1 < text.size())
+				Wait(milliseconds);
+		}
+	}
+};
+
+/* TIMED MACRO */
+
+TimedMacro::TimedMacro(const std::vector<MacroStep>& steps, const InputInjector& inputInjector)
+{
+	Timeline timeline;
+	timeline.AddSteps(steps);
+
+	if (timeline.truncated)
+		std::cerr << "[WARNING] Timed macro cut to " << s_maxEvents << " events" << std::endl;
+
+	m_duration = timeline.timeMs;
+
+	// release what is still down
+
+	for (int key = 0; key < 256; key++)
+	{
+		if (timeline.down[key])
+			timeline.events.push_back(Timeline::TimedEvent{ m_duration, InputEvent{ (uint8_t)key, true } });
+	}
+
+	// one batch per time
+
+	std::vector<InputEvent> events;
+
+	for (size_t i = 0; i < timeline.events.size(); i++)
+	{
+		events.push_back(timeline.events[i].event);
+
+		if (i + 1 == timeline.events.size() || timeline.events[i + 1].timeMs != timeline.events[i].timeMs)
+		{
+			m_batches.push_back(Batch{ timeline.events[i].timeMs, inputInjector.Compile(std::move(events)) });
+			events.clear();
+		}
+	}
+}
+
+bool TimedMacro::GetCharacterKey(char character, unsigned char& key, bool& shift)
+{
+	shift = false;
+
+	if (character >= 'a' && character <= 'z')
+	{
+		key = (unsigned char)(character - 'a' + 'A');
+		return true;
+	}
+
+	if ((character >= 'A' && character <= 'Z') || (character >= '0' && character <= '9'))
+	{
+		key = (unsigned char)character;
+		shift = character >= 'A' && character <= 'Z';
+		return true;
+	}
+
+	// us layout, the unshifted & shifted character of every key
+
+	static const struct { unsigned char key; char normal; char shifted; } keys[] = {
+		{ '1', '1', '!' }, { '2', '2', '@' }, { '3', '3', '#' }, { '4', '4', '$' }, { '5', '5', '%' },
+		{ '6', '6', '^' }, { '7', '7', '&' }, { '8', '8', '*' }, { '9', '9', '(' }, { '0', '0', ')' },
+		{ 0xBA, ';', ':' }, { 0xBB, '=', '+' }, { 0xBC, ',', '<' }, { 0xBD, '-', '_' }, { 0xBE, '.', '>' },
+		{ 0xBF, '/', '?' }, { 0xC0, '`', '~' }, { 0xDB, '[', '{' }, { 0xDC, '\\', '|' }, { 0xDD, ']', '}' },
+		{ 0xDE, '\'', '"' }, { 0x20, ' ', 0 }, { 0x0D, '\n', 0 }, { 0x09, '\t', 0 }
+	};
+
+	for (const auto& entry : keys)
+	{
+		if (entry.normal == character || (entry.shifted != 0 && entry.shifted == character))
+		{
+			key = entry.key;
+			shift = entry.normal != character;
+			return true;
+		}
+	}
+
+	return false;
+}
@@ -0,0 +1,198 @@
+#ifdef __linux__
+
+#include "UinputInjector.h"
+#include <linux/uinput.h>
+#include <sys/ioctl.h>
+#include <sys/uio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+// windows virtual key -> linux key code (0 if it has no equivalent)
+
+static uint16_t TranslateKey(uint8_t virtualKey)
+{
+	if (virtualKey >= 'A' && virtualKey <= 'Z')
+	{
+		static const uint16_t letters[] = {
+			KEY_A, KEY_B, KEY_C, KEY_D, KEY_E, KEY_F, KEY_G, KEY_H, KEY_I, KEY_J, KEY_K, KEY_L, KEY_M,
+			KEY_N, KEY_O, KEY_P, KEY_Q, KEY_R, KEY_S, KEY_T, KEY_U, KEY_V, KEY_W, KEY_X, KEY_Y, KEY_Z
+		};
+
+		return letters[virtualKey - 'A'];
+	}
+
+	if (virtualKey >= '1' && virtualKey <= '9')
+		return KEY_1 + (virtualKey - '1');
+
+	if (virtualKey >= 0x70 && virtualKey <= 0x79) // F1 - F10
+		return KEY_F1 + (virtualKey - 0x70);
+
+	switch (virtualKey)
+	{
+	case '0': return KEY_0;
+	case 0x7A: return KEY_F11;
+	case 0x7B: return KEY_F12;
+	case 0x08: return KEY_BACKSPACE;
+	case 0x09: return KEY_TAB;
+	case 0x0D: return KEY_ENTER;
+	case 0x10: case 0xA0: return KEY_LEFTSHIFT;
+	case 0xA1: return KEY_RIGHTSHIFT;
+	case 0x11: case 0xA2: return KEY_LEFTCTRL;
+	case 0xA3: return KEY_RIGHTCTRL;
+	case 0x12: case 0xA4: return KEY_LEFTALT;
+	case 0xA5: return KEY_RIGHTALT;
+	case 0x1B: return KEY_ESC;
+	case 0x20: return KEY_SPACE;
+	case 0x21: return KEY_PAGEUP;
+	case 0x22: return KEY_PAGEDOWN;
+	case 0x23: return KEY_END;
+	case 0x24: return KEY_HOME;
+	case 0x25: return KEY_LEFT;
+	case 0x26: return KEY_UP;
+	case 0x27: return KEY_RIGHT;
+	case 0x28: return KEY_DOWN;
+	case 0x2C: return KEY_SYSRQ;
+	case 0x2D: return KEY_INSERT;
+	case 0x2E: return KEY_DELETE;
+	case 0x5B: return KEY_LEFTMETA;
+	case 0x5C: return KEY_RIGHTMETA;
+	case 0xAD: return KEY_MUTE;
+	case 0xAE: return KEY_VOLUMEDOWN;
+	case 0xAF: return KEY_VOLUMEUP;
+	case 0xB0: return KEY_NEXTSONG;
+	case 0xB1: return KEY_PREVIOUSSONG;
+	case 0xB2: return KEY_STOPCD;
+	case 0xB3: return KEY_PLAYPAUSE;
+	case 0xBA: return KEY_SEMICOLON; // us layout oem keys
+	case 0xBB: return KEY_EQUAL;
+	case 0xBC: return KEY_COMMA;
+	case 0xBD: return KEY_MINUS;
+	case 0xBE: return KEY_DOT;
+	case 0xBF: return KEY_SLASH;
+	case 0xC0: return KEY_GRAVE;
+	case 0xDB: return KEY_LEFTBRACE;
+	case 0xDC: return KEY_BACKSLASH;
+	case 0xDD: return KEY_RIGHTBRACE;
+	case 0xDE: return KEY_APOSTROPHE;
+	default: return 0;
+	}
+}
+
+class UinputSequence : public InputSequence
+{
+public:
+	explicit UinputSequence(std::vector<InputEvent> events)
+		: InputSequence(std::move(events))
+	{
+		// every key event is followed by a sync so it is reported on its own
+
+		for (const InputEvent& event : GetEvents())
+		{
+			uint16_t code = TranslateKey(event.key);
+
+			if (code == 0)
+				continue;
+
+			input_event keyEvent = {};
+			keyEvent.type = EV_KEY;
+			keyEvent.code = code;
+			keyEvent.value = event.release ? 0 : 1;
+
+			input_event syncEvent = {};
+			syncEvent.type = EV_SYN;
+			syncEvent.code = SYN_REPORT;
+
+			m_inputEvents.push_back(keyEvent);
+			m_inputEvents.push_back(syncEvent);
+		}
+	}
+
+	const std::vector<input_event>& GetInputEvents() const { return m_inputEvents; }
+
+private:
+	std::vector<input_event> m_inputEvents;
+};
+
+/* UINPUT INJECTOR */
+
+UinputInjector::UinputInjector()
+{
+	m_fd = open("/dev/uinput", O_WRONLY | O_NONBLOCK | O_CLOEXEC);
+
+	if (m_fd < 0)
+	{
+		std::cerr << "[WARNING] /dev/uinput couldn't be opened: " << std::strerror(errno) << std::endl;
+		return;
+	}
+
+	// a keyboard with every key a virtual key can be translated to
+
+	ioctl(m_fd, UI_SET_EVBIT, EV_KEY);
+	ioctl(m_fd, UI_SET_EVBIT, EV_SYN);
+
+	for (int virtualKey = 0; virtualKey < 256; virtualKey++)
+	{
+		uint16_t code = TranslateKey((uint8_t)virtualKey);
+
+		if (code != 0)
+			ioctl(m_fd, UI_SET_KEYBIT, code);
+	}
+
+	uinput_setup setup = {};
+	setup.id.bustype = BUS_VIRTUAL;
+	setup.id.vendor = 0x2341; // arduino
+	setup.id.product = 0x4D50;
+	std::strncpy(setup.name, "Arduino Macro Pad", UINPUT_MAX_NAME_SIZE - 1);
+
+	if (ioctl(m_fd, UI_DEV_SETUP, &setup) < 0 || ioctl(m_fd, UI_DEV_CREATE) < 0)
+	{
+		std::cerr << "[WARNING] The uinput keyboard couldn't be created: " << std::strerror(errno) << std::endl;
+
+		close(m_fd);
+		m_fd = -1;
+	}
+}
+
+UinputInjector::~UinputInjector()
+{
+	if (m_fd >= 0)
+	{
+		ioctl(m_fd, UI_DEV_DESTROY);
+		close(m_fd);
+	}
+}
+
+std::shared_ptr<const InputSequence> UinputInjector::Compile(std::vector<InputEvent> events) const
+{
+	return std::make_shared<const UinputSequence>(std::move(events));
+}
+
+void UinputInjector::Inject(const InputSequence& sequence, unsigned int repeatCount)
+{
+	const std::vector<input_event>& inputEvents = static_cast<const UinputSequence&>(sequence).GetInputEvents();
+
+	if (m_fd < 0 || inputEvents.empty())
+		return;
+
+	// every repeat points to the same events
+
+	iovec repeats[s_maxBatchedRepeats];
+
+	for (unsigned int i = 0; i < s_maxBatchedRepeats; i++)
+		repeats[i] = iovec{ (void*)inputEvents.data(), inputEvents.size() * sizeof(input_event) };
+
+	while (repeatCount > 0)
+	{
+		unsigned int batch = std::min(repeatCount, s_maxBatchedRepeats);
+
+		if (writev(m_fd, repeats, batch) < 0)
+			std::cerr << "[WARNING] uinput write failed: " << std::strerror(errno) << std::endl;
+
+		repeatCount -= batch;
+	}
+}
+
+#endif
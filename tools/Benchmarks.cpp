@@ -0,0 +1,633 @@
+// Microbenchmarks of the controller hot paths on Linux, without the controller, a window or a macro pad: the commands
+// are scratch tables, the keys go to a recording injector and the serial port is a pseudo terminal written by the
+// benchmark (the same path as a real port through MacroPadDevice)
+//
+// usage: Benchmarks [results.json]   (benchmark.json by default, run from the repo root so assets/scripts is found)
+//
+// build: g++ -std=c++20 -O2 -Iinclude -Ivendor -Ivendor/asio-1.28.0/include -Ivendor/json/include -Ivendor/lua-5.4.2/include
+//        tools/Benchmarks.cpp src/Core/Benchmark.cpp src/Core/LatencyHistogram.cpp src/Core/ThreadPool.cpp src/Core/TimerWheel.cpp
+//        src/ActionExecutor.cpp src/CommandTable.cpp src/Config.cpp src/CreateProcessLauncher.cpp src/InputInjector.cpp
+//        src/LedBuffer.cpp src/LedEffectEngine.cpp src/LedFrameEncoder.cpp src/LedFrameScheduler.cpp src/LedGeometry.cpp
+//        src/LedProtocol.cpp src/LedQuantizer.cpp src/LuaLedBuffer.cpp src/LuaScriptCache.cpp src/MacroPadDevice.cpp
+//        src/MacroScheduler.cpp src/PosixSpawnLauncher.cpp src/ProcessLauncher.cpp src/ProfileManager.cpp
+//        src/RecordingInputInjector.cpp src/ScriptWorker.cpp src/TimedMacro.cpp src/UinputInjector.cpp
+//        -o Benchmarks -llua5.4 -lutil -lpthread
+
+#include "ActionExecutor.h"
+#include "CommandTable.h"
+#include "Config.h"
+#include "LedBuffer.h"
+#include "LedEffectEngine.h"
+#include "LedFrameEncoder.h"
+#include "LedGeometry.h"
+#include "LuaLedBuffer.h"
+#include "LuaScriptCache.h"
+#include "MacroPadDevice.h"
+#include "ProfileManager.h"
+#include "RecordingInputInjector.h"
+#include "Core/Benchmark.h"
+#include "Core/ThreadPool.h"
+#include <pty.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <termios.h>
+#include <cerrno>
+#include <cmath>
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+extern "C"
+{
+#include <lua.h>
+#include <lualib.h>
+#include <lauxlib.h>
+}
+
+using namespace nlohmann; // for using json instead of nlohmann::json
+
+// windows virtual keys of the default commands of the controller (the recording injector takes them on any platform)
+
+static constexpr unsigned char g_vkShift = 0x10;
+static constexpr unsigned char g_vkLeftWindows = 0x5B;
+static constexpr unsigned char g_vkVolumeMute = 0xAD;
+static constexpr unsigned char g_vkVolumeDown = 0xAE;
+static constexpr unsigned char g_vkVolumeUp = 0xAF;
+static constexpr unsigned char g_vkMediaNextTrack = 0xB0;
+static constexpr unsigned char g_vkMediaPrevTrack = 0xB1;
+static constexpr unsigned char g_vkMediaPlayPause = 0xB3;
+
+static bool CheckLua(lua_State* l, int r)
+{
+	if (r != LUA_OK)
+	{
+		std::cerr << "[WARNING] " << lua_tostring(l, -1) << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+static MacroStep Step(MacroStepType type)
+{
+	MacroStep step;
+	step.type = type;
+
+	return step;
+}
+
+static Action KeyMacroAction(std::vector<unsigned char> keys)
+{
+	Action action;
+	action.type = KEY_MACRO;
+	action.keys = std::move(keys);
+
+	return action;
+}
+
+// the same commands as the default profile of the controller (media keys & one action per key of the matrix) and a
+// timed macro so the config has every kind of field
+
+static CommandsMap BuildCommands()
+{
+	CommandsMap commandsMap;
+
+	commandsMap["VOLUMEUP"] = KeyMacroAction({ g_vkVolumeUp });
+	commandsMap["VOLUMEDOWN"] = KeyMacroAction({ g_vkVolumeDown });
+	commandsMap["NEXTTRACK"] = KeyMacroAction({ g_vkMediaNextTrack });
+	commandsMap["PREVTRACK"] = KeyMacroAction({ g_vkMediaPrevTrack });
+	commandsMap["PLAYPAUSE"] = KeyMacroAction({ g_vkMediaPlayPause });
+	commandsMap["MUTE"] = KeyMacroAction({ g_vkVolumeMute });
+
+	for (int i = 0; i < 441; i++)
+	{
+		Action keyAction;
+		keyAction.type = OPEN_PROCESS;
+		keyAction.processPath = "/usr/bin/true";
+		commandsMap["KEY" + std::to_string(i)] = keyAction;
+	}
+
+	commandsMap["KEY5"] = KeyMacroAction({ g_vkLeftWindows, g_vkShift, (unsigned char)'S' });
+
+	MacroStep textStep = Step(MacroStepType::TEXT);
+	textStep.text = "hola";
+	textStep.milliseconds = 10;
+
+	MacroStep tapStep = Step(MacroStepType::TAP);
+	tapStep.key = 'A';
+
+	MacroStep repeatStep = Step(MacroStepType::REPEAT);
+	repeatStep.count = 3;
+	repeatStep.steps = { tapStep };
+
+	Action typeAction;
+	typeAction.type = TIMED_MACRO;
+	typeAction.steps = { textStep, repeatStep };
+	commandsMap["TYPE"] = typeAction;
+
+	return commandsMap;
+}
+
+// set_led(index, r, g, b) on the scratch leds, the same work as the one of the controller
+
+static int SetLedLuaWrap(lua_State* l)
+{
+	LedBuffer* leds = (LedBuffer*)lua_touserdata(l, lua_upvalueindex(1));
+	size_t index = lua_tointeger(l, 1);
+
+	if (index < leds->GetNumLeds())
+		(*leds)[index] = { (uint8_t)lua_tointeger(l, 2), (uint8_t)lua_tointeger(l, 3), (uint8_t)lua_tointeger(l, 4) };
+
+	return 0;
+}
+
+// a lua state with the led functions of the controller on scratch leds
+
+static lua_State* NewLedScriptState(LedBuffer& leds, const LedGeometry& geometry)
+{
+	lua_State* l = luaL_newstate();
+	luaL_openlibs(l);
+
+	lua_pushlightuserdata(l, &leds);
+	lua_pushcclosure(l, SetLedLuaWrap, 1);
+	lua_setglobal(l, "set_led");
+
+	LuaLedBuffer::Register(l, "leds", leds, geometry);
+
+	return l;
+}
+
+/* CASES */
+
+static void RunCommandBenchmarks(Benchmark& benchmark, const CommandsMap& commandsMap)
+{
+	RecordingInputInjector inputInjector;
+	CommandTable commandTable(commandsMap, &inputInjector);
+
+	// lookups of every name in turn & a name that isn't there
+
+	std::vector<std::string> commandNames;
+
+	for (uint16_t id = 0; id < commandTable.GetNumCommands(); id++)
+		commandNames.emplace_back(commandTable.GetName(id));
+
+	benchmark.Run("command_lookup", [&](uint64_t iterations) {
+		uint64_t found = 0;
+
+		for (uint64_t i = 0; i < iterations; i++)
+			found += commandTable.Find(commandNames[i % commandNames.size()]);
+
+		Benchmark::Consume(found);
+	});
+
+	benchmark.Run("command_lookup_miss", [&](uint64_t iterations) {
+		uint64_t found = 0;
+
+		for (uint64_t i = 0; i < iterations; i++)
+			found += commandTable.Find("NOT_A_COMMAND");
+
+		Benchmark::Consume(found);
+	});
+
+	// key macro events, built & compiled (nothing is injected)
+
+	const std::vector<unsigned char> keys = { g_vkLeftWindows, g_vkShift, (unsigned char)'S' };
+
+	benchmark.Run("key_macro_events", [&](uint64_t iterations) {
+		for (uint64_t i = 0; i < iterations; i++)
+			Benchmark::Consume(InputInjector::BuildKeyMacroEvents(keys).size());
+	});
+
+	benchmark.Run("key_macro_compile", [&](uint64_t iterations) {
+		for (uint64_t i = 0; i < iterations; i++)
+			Benchmark::Consume(inputInjector.Compile(InputInjector::BuildKeyMacroEvents(keys))->GetEvents().size());
+	});
+}
+
+// waits until the recorder saw the inject calls, the recorded events are dropped after every sample
+
+static void WaitForInjectCalls(RecordingInputInjector& recorder, size_t injectCalls)
+{
+	while (recorder.GetInjectCalls() < injectCalls)
+		std::this_thread::yield();
+}
+
+static void RunExecutorBenchmarks(Benchmark& benchmark, const CommandsMap& commandsMap)
+{
+	asio::io_context io;
+	auto recordingInputInjector = std::make_unique<RecordingInputInjector>();
+	RecordingInputInjector& recorder = *recordingInputInjector;
+	ActionExecutor actionExecutor(std::move(recordingInputInjector), CreatePlatformProcessLauncher(io));
+
+	auto commandTable = std::make_shared<const CommandTable>(commandsMap, &actionExecutor.GetInputInjector(), nullptr);
+
+	// lookup -> executor -> injected
+
+	benchmark.Run("process_command", [&](uint64_t iterations) {
+		size_t injectCalls = recorder.GetInjectCalls() + iterations;
+
+		for (uint64_t i = 0; i < iterations; i++)
+			actionExecutor.Submit(commandTable, commandTable->Find("VOLUMEUP"));
+
+		WaitForInjectCalls(recorder, injectCalls);
+		recorder.Clear();
+	});
+
+	// a line written to the serial port -> read & split by the device -> executor -> injected
+	// the port is a pseudo terminal, the frames the device sends back (hello) are read & dropped
+
+	int master, slave;
+	char portName[256];
+
+	if (openpty(&master, &slave, portName, nullptr, nullptr) != 0)
+	{
+		std::cerr << "[WARNING] openpty failed, skipping serial_command" << std::endl;
+		return;
+	}
+
+	termios settings;
+	tcgetattr(slave, &settings);
+	cfmakeraw(&settings);
+	tcsetattr(slave, TCSANOW, &settings);
+	fcntl(master, F_SETFL, fcntl(master, F_GETFL) | O_NONBLOCK);
+
+	ProfileManager profileManager;
+	profileManager.SetProfiles({ { Config::s_defaultProfile, commandTable } });
+
+	auto device = std::make_shared<MacroPadDevice>(io, portName, 115200, profileManager, actionExecutor);
+	device->SetCoalesceWindowMs(0); // one action per line
+
+	if (device->Open())
+	{
+		auto workGuard = asio::make_work_guard(io);
+		std::thread ioThread([&io]() { io.run(); });
+
+		const std::string line = "VOLUMEUP\n";
+		char discard[4096];
+
+		benchmark.Run("serial_command", [&](uint64_t iterations) {
+			size_t injectCalls = recorder.GetInjectCalls() + iterations;
+
+			for (uint64_t i = 0; i < iterations; i++)
+			{
+				size_t written = 0;
+
+				while (written < line.size())
+				{
+					ssize_t result = write(master, line.data() + written, line.size() - written);
+
+					if (result > 0)
+					{
+						written += result;
+						continue;
+					}
+
+					if (result < 0 && errno != EAGAIN)
+						return;
+
+					// the device is behind, wait for room (and drop what it sent)
+
+					pollfd fd = { master, POLLOUT | POLLIN, 0 };
+					poll(&fd, 1, 10);
+
+					while (read(master, discard, sizeof(discard)) > 0)
+						;
+				}
+			}
+
+			WaitForInjectCalls(recorder, injectCalls);
+			recorder.Clear();
+		});
+
+		device->Close();
+		workGuard.reset();
+		io.stop();
+		ioThread.join();
+	}
+
+	close(master);
+	close(slave);
+}
+
+static void RunScriptBenchmarks(Benchmark& benchmark)
+{
+	LedGeometry geometry;
+	LedBuffer leds(geometry.GetNumLeds());
+
+	// loading (parsed & against the bytecode cache) & update_leds of every bundled script, each one in its own lua state
+
+	for (const auto& entry : std::filesystem::directory_iterator("assets/scripts"))
+	{
+		if (entry.path().extension() != ".lua")
+			continue;
+
+		lua_State* l = NewLedScriptState(leds, geometry);
+		const std::string scriptPath = entry.path().string();
+		const std::string scriptName = entry.path().filename().string();
+
+		benchmark.Run("script_load/" + scriptName + "/source", [&](uint64_t iterations) {
+			for (uint64_t i = 0; i < iterations; i++)
+			{
+				luaL_loadfile(l, scriptPath.c_str());
+				lua_settop(l, 0);
+			}
+		});
+
+		benchmark.Run("script_load/" + scriptName + "/cached", [&](uint64_t iterations) {
+			for (uint64_t i = 0; i < iterations; i++)
+			{
+				LuaScriptCache::LoadFile(l, scriptPath);
+				lua_settop(l, 0);
+			}
+		});
+
+		bool hasUpdateLeds = LuaScriptCache::DoFile(l, scriptPath) == LUA_OK && lua_getglobal(l, "update_leds") == LUA_TFUNCTION;
+
+		lua_settop(l, 0);
+
+		if (hasUpdateLeds)
+		{
+			benchmark.Run("update_leds/" + scriptName, [&](uint64_t iterations) {
+				for (uint64_t i = 0; i < iterations; i++)
+				{
+					lua_getglobal(l, "update_leds");
+					lua_pushnumber(l, i * 0.016);
+					CheckLua(l, lua_pcall(l, 1, 0, 0));
+				}
+			});
+		}
+
+		lua_close(l);
+	}
+
+	// a whole frame from lua, one set_led per led against the led buffer (indexed & bulk)
+
+	lua_State* l = NewLedScriptState(leds, geometry);
+
+	const std::pair<std::string, const char*> frames[] = {
+		{ "lua_frame/set_led", "for i = 0, #leds - 1 do set_led(i, 175, 45, 246) end" },
+		{ "lua_frame/index", "for i = 0, #leds - 1 do leds[i] = 0xAF2DF6 end" },
+		{ "lua_frame/fill", "leds:fill(0xAF2DF6)" }
+	};
+
+	for (const auto& [name, chunk] : frames)
+	{
+		if (!CheckLua(l, luaL_loadstring(l, chunk)))
+		{
+			lua_settop(l, 0);
+			continue;
+		}
+
+		benchmark.Run(name, [&](uint64_t iterations) {
+			for (uint64_t i = 0; i < iterations; i++)
+			{
+				lua_pushvalue(l, 1);
+				CheckLua(l, lua_pcall(l, 0, 0, 0));
+				lua_settop(l, 1);
+			}
+		});
+
+		lua_settop(l, 0);
+	}
+
+	lua_close(l);
+}
+
+static void RunLedBenchmarks(Benchmark& benchmark)
+{
+	// native led effects with the default parameters, on the leds of the macro pad & on 10k leds
+
+	for (const auto& [width, height] : { std::pair(LedGeometry::s_defaultWidth, LedGeometry::s_defaultHeight), std::pair(100, 100) })
+	{
+		LedEffectEngine ledEffectEngine(width, height);
+		LedBuffer leds(ledEffectEngine.GetNumLeds());
+
+		for (int type = (int)LedEffectType::SOLID; type <= (int)LedEffectType::RADIAL_SINE; type++)
+		{
+			LedEffect effect;
+			effect.type = (LedEffectType)type;
+			ledEffectEngine.SetEffect(effect);
+
+			std::string name = "led_effect/" + Config::GetLedEffectTypeName(effect.type) + "/" + std::to_string(ledEffectEngine.GetNumLeds());
+
+			benchmark.Run(name, [&](uint64_t iterations) {
+				for (uint64_t i = 0; i < iterations; i++)
+					ledEffectEngine.Render(i * 0.016f, leds.GetData());
+
+				Benchmark::Consume(leds.GetData()[0]);
+			});
+		}
+	}
+
+	// matrix -> wiring order of 10k leds on four serpentine panels
+
+	LedGeometry ledGeometry(100, 100, {
+		{ 0, 0, 50, 50, LedWiring::SERPENTINE },
+		{ 50, 0, 50, 50, LedWiring::SERPENTINE },
+		{ 0, 50, 50, 50, LedWiring::SERPENTINE },
+		{ 50, 50, 50, 50, LedWiring::SERPENTINE }
+	});
+
+	LedBuffer matrix(ledGeometry.GetNumLeds());
+	LedBuffer wired(ledGeometry.GetNumWiredLeds());
+
+	benchmark.Run("led_wiring/" + std::to_string(ledGeometry.GetNumWiredLeds()), [&](uint64_t iterations) {
+		for (uint64_t i = 0; i < iterations; i++)
+			ledGeometry.ToWiringOrder(matrix.GetData(), wired.GetData());
+
+		Benchmark::Consume(wired.GetData()[0]);
+	});
+}
+
+// frames of a script at 60 fps, as they would be sent (empty if the script fails)
+
+static std::vector<std::vector<uint8_t>> RecordScriptFrames(const std::string& scriptPath, size_t numFrames)
+{
+	LedGeometry geometry;
+	LedBuffer leds(geometry.GetNumLeds());
+	lua_State* l = NewLedScriptState(leds, geometry);
+	std::vector<std::vector<uint8_t>> frames;
+
+	if (CheckLua(l, LuaScriptCache::DoFile(l, scriptPath)))
+	{
+		for (size_t i = 0; i < numFrames; i++)
+		{
+			lua_getglobal(l, "update_leds");
+			lua_pushnumber(l, i / 60.0);
+
+			if (!CheckLua(l, lua_pcall(l, 1, 0, 0)))
+			{
+				frames.clear();
+				break;
+			}
+
+			frames.emplace_back(leds.GetData(), leds.GetData() + leds.GetSize());
+		}
+	}
+
+	lua_close(l);
+
+	return frames;
+}
+
+static void RunQuantizerBenchmarks(Benchmark& benchmark, std::map<std::string, json>& metrics)
+{
+	// keyframes of the recorded frames of the scripts in every color format: time, bytes on the wire and quality
+	// (the psnr of rgb888 is lossless, null in the json)
+
+	const std::pair<LedColorFormat, const char*> colorFormats[] = {
+		{ LedColorFormat::Rgb888, "rgb888" },
+		{ LedColorFormat::Rgb565, "rgb565" },
+		{ LedColorFormat::Palette, "palette" }
+	};
+
+	for (const char* scriptName : { "rainbow.lua", "sine2d.lua" })
+	{
+		std::vector<std::vector<uint8_t>> frames = RecordScriptFrames(std::string("assets/scripts/") + scriptName, 120);
+
+		if (frames.empty())
+			continue;
+
+		for (const auto& [colorFormat, colorFormatName] : colorFormats)
+		{
+			LedFrameEncoder encoder;
+			encoder.SetColorFormat(colorFormat);
+			encoder.SetSupportedFrameTypes(~0u);
+
+			size_t bytes = 0;
+			double psnrSum = 0.0;
+			size_t psnrFrames = 0;
+
+			for (const std::vector<uint8_t>& frame : frames)
+			{
+				bytes += encoder.Encode(frame.data(), frame.size(), LedEncoding::Full).GetSize();
+
+				if (std::isfinite(encoder.GetLastFramePsnr()))
+				{
+					psnrSum += encoder.GetLastFramePsnr();
+					psnrFrames++;
+				}
+			}
+
+			std::string name = std::string("led_quantize/") + scriptName + "/" + colorFormatName;
+
+			metrics[name]["bytes_per_frame"] = (double)bytes / frames.size();
+			metrics[name]["psnr_db"] = psnrFrames > 0 ? json(psnrSum / psnrFrames) : json(nullptr);
+
+			benchmark.Run(name, [&](uint64_t iterations) {
+				for (uint64_t i = 0; i < iterations; i++)
+				{
+					const std::vector<uint8_t>& frame = frames[i % frames.size()];
+					Benchmark::Consume(encoder.Encode(frame.data(), frame.size(), LedEncoding::Full).payloadSize);
+				}
+			});
+		}
+	}
+}
+
+static void RunConfigBenchmarks(Benchmark& benchmark, const CommandsMap& commandsMap)
+{
+	// a scratch config like the one the controller saves, (de)serialized in memory & compiled like CompileCommands
+
+	Config config;
+	config.profiles[Config::s_defaultProfile].commandsMap = commandsMap;
+	config.profiles["editor"].commandsMap = commandsMap;
+	config.profiles["editor"].applications = { "code", "vim" };
+	config.activeProfile = Config::s_defaultProfile;
+	config.ledEffect = LedEffect();
+	config.ledGeometry = LedGeometry(42, 21, { { 0, 0, 21, 21, LedWiring::SERPENTINE }, { 21, 0, 21, 21, LedWiring::SERPENTINE } }, { { "KEY5", 5, 0, 3, 3 } });
+
+	const std::string text = config.Serialize();
+
+	benchmark.Run("serialize_config", [&](uint64_t iterations) {
+		for (uint64_t i = 0; i < iterations; i++)
+			Benchmark::Consume(config.Serialize().size());
+	});
+
+	benchmark.Run("deserialize_config", [&](uint64_t iterations) {
+		for (uint64_t i = 0; i < iterations; i++)
+			Benchmark::Consume(Config::Deserialize(text).profiles.size());
+	});
+
+	RecordingInputInjector inputInjector;
+
+	benchmark.Run("compile_profiles", [&](uint64_t iterations) {
+		for (uint64_t i = 0; i < iterations; i++)
+		{
+			for (const auto& [profileName, profile] : config.profiles)
+				Benchmark::Consume(CommandTable(profile.commandsMap, &inputInjector).GetNumCommands());
+		}
+	});
+}
+
+static void RunThreadPoolBenchmarks(Benchmark& benchmark)
+{
+	// submitted & run
+
+	ThreadPool threadPool(2);
+	std::atomic<uint64_t> tasksDone = 0;
+
+	benchmark.Run("thread_pool_submit", [&](uint64_t iterations) {
+		uint64_t target = tasksDone + iterations;
+
+		for (uint64_t i = 0; i < iterations; i++)
+			threadPool.SubmitTask([&tasksDone]() { tasksDone++; });
+
+		while (tasksDone < target)
+			std::this_thread::yield();
+	});
+}
+
+int main(int argc, char** argv)
+{
+	const std::string path = argc > 1 ? argv[1] : "benchmark.json";
+	const CommandsMap commandsMap = BuildCommands();
+	Benchmark benchmark;
+	std::map<std::string, json> metrics; // other measures of a case, added to its result
+
+	RunCommandBenchmarks(benchmark, commandsMap);
+	RunExecutorBenchmarks(benchmark, commandsMap);
+	RunScriptBenchmarks(benchmark);
+	RunLedBenchmarks(benchmark);
+	RunQuantizerBenchmarks(benchmark, metrics);
+	RunConfigBenchmarks(benchmark, commandsMap);
+	RunThreadPoolBenchmarks(benchmark);
+
+	// results
+
+	json benchmarkFile;
+	benchmarkFile["benchmarks"] = json::array();
+
+	for (const Benchmark::Result& result : benchmark.GetResults())
+	{
+		json jsonResult = {
+			{ "name", result.name },
+			{ "iterations", result.iterations },
+			{ "median_ns", result.medianNs },
+			{ "min_ns", result.minNs },
+			{ "max_ns", result.maxNs }
+		};
+
+		auto it = metrics.find(result.name);
+
+		if (it != metrics.end())
+			jsonResult.update(it->second);
+
+		benchmarkFile["benchmarks"].push_back(jsonResult);
+
+		std::cout << "[INFO] " << result.name << ": " << result.medianNs << " ns/op" << (it != metrics.end() ? " " + it->second.dump() : "") << std::endl;
+	}
+
+	std::ofstream file(path);
+	file << benchmarkFile.dump(4);
+
+	return 0;
+}
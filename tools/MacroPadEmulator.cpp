@@ -0,0 +1,362 @@
+// Software macro pad for Linux, emulates arduino_code/macropad.ino on a pseudo terminal so the controller
+// can be load tested without hardware (connect with ConnectToPort using the printed port name)
+//
+// usage: MacroPadEmulator [options]
+//   --leds <n>             leds reported in the capabilities (441)
+//   --max-baud <baud>      max baud rate reported in the capabilities (1000000)
+//   --rate <n>             command bursts per second (10)
+//   --burst <n>            commands per burst (1)
+//   --commands <a,b,...>   commands sent round robin (Comando1,Comando2)
+//   --knob-spins <n>       knob spins per second, each spin is knob steps Subir or Bajar lines (0)
+//   --knob-steps <n>       lines per knob spin (10)
+//   --duration <seconds>   time to run, 0 runs until ctrl+c (0)
+//   --no-ack               don't acknowledge the led frames
+//   --names                always send the command names (no command ids)
+//
+// build: g++ -std=c++20 -O2 -Iinclude tools/MacroPadEmulator.cpp src/LedFrameDecoder.cpp src/LedProtocol.cpp -lutil
+
+#include "LedFrameDecoder.h"
+#include <pty.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <termios.h>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+struct EmulatorOptions
+{
+	uint32_t numLeds = 441;
+	uint32_t maxBaudRate = 1000000;
+	double rate = 10.0;
+	uint32_t burst = 1;
+	std::vector<std::string> commands = { "Comando1", "Comando2" };
+	double knobSpins = 0.0;
+	uint32_t knobSteps = 10;
+	double duration = 0.0;
+	bool acknowledge = true;
+	bool commandIds = true;
+};
+
+struct EmulatorStats
+{
+	uint64_t commandsSent = 0;
+	uint64_t commandsDropped = 0; // the host wasn't reading
+	uint64_t bytesReceived = 0;
+	uint64_t framesApplied = 0;
+	uint64_t framesInvalid = 0; // valid crc but couldn't be applied
+	uint64_t framesLost = 0; // gaps in the sequence numbers
+	uint64_t controlFrames = 0;
+};
+
+static std::atomic<bool> g_running = true;
+
+static const uint32_t g_supportedFrameTypes =
+	(1u << (int)LedFrameType::Full) | (1u << (int)LedFrameType::RleFull) | (1u << (int)LedFrameType::Delta) |
+	(1u << (int)LedFrameType::Full565) | (1u << (int)LedFrameType::Palette) | (1u << (int)LedFrameType::CommandIds);
+
+static void OnSignal(int)
+{
+	g_running = false;
+}
+
+static bool ParseOptions(int argc, char** argv, EmulatorOptions& options)
+{
+	for (int i = 1; i < argc; i++)
+	{
+		std::string option = argv[i];
+		bool hasValue = i + 1 < argc;
+
+		if (option == "--no-ack")
+			options.acknowledge = false;
+		else if (option == "--names")
+			options.commandIds = false;
+		else if (option == "--leds" && hasValue)
+			options.numLeds = std::strtoul(argv[++i], nullptr, 10);
+		else if (option == "--max-baud" && hasValue)
+			options.maxBaudRate = std::strtoul(argv[++i], nullptr, 10);
+		else if (option == "--rate" && hasValue)
+			options.rate = std::strtod(argv[++i], nullptr);
+		else if (option == "--burst" && hasValue)
+			options.burst = std::strtoul(argv[++i], nullptr, 10);
+		else if (option == "--knob-spins" && hasValue)
+			options.knobSpins = std::strtod(argv[++i], nullptr);
+		else if (option == "--knob-steps" && hasValue)
+			options.knobSteps = std::strtoul(argv[++i], nullptr, 10);
+		else if (option == "--duration" && hasValue)
+			options.duration = std::strtod(argv[++i], nullptr);
+		else if (option == "--commands" && hasValue)
+		{
+			options.commands.clear();
+
+			std::string list = argv[++i];
+			size_t start = 0;
+
+			while (start <= list.size())
+			{
+				size_t end = list.find(',', start);
+
+				if (end == std::string::npos)
+					end = list.size();
+
+				if (end > start)
+					options.commands.push_back(list.substr(start, end - start));
+
+				start = end + 1;
+			}
+		}
+		else
+		{
+			std::fprintf(stderr, "Unknown option: %s\n", option.c_str());
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// write a line to the host, lines that don't fit are dropped like on a full usb buffer
+
+static bool WriteLine(int fd, const std::string& line)
+{
+	std::string data = line + "\r\n";
+
+	return write(fd, data.data(), data.size()) == (ssize_t)data.size();
+}
+
+// micros() of the emulated arduino, 32 bits so it wraps like the real one
+
+static uint32_t Micros()
+{
+	static const Clock::time_point start = Clock::now();
+
+	return (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count();
+}
+
+// input event line, the command (or its id once the host asked for them) followed by the time it happened
+
+static bool WriteEvent(int fd, const std::vector<std::string>& commandNames, size_t command, bool commandIds)
+{
+	std::string name = commandIds ? "#" + std::to_string(command) : commandNames[command];
+
+	return WriteLine(fd, name + "\t" + std::to_string(Micros()));
+}
+
+static void PrintStats(const EmulatorStats& stats, const EmulatorStats& last, double seconds)
+{
+	std::printf("cmds %.0f/s (%llu dropped), frames %.1f/s, rx %.0f bytes/s, invalid %llu, lost %llu\n",
+		(stats.commandsSent - last.commandsSent) / seconds,
+		(unsigned long long)stats.commandsDropped,
+		(stats.framesApplied - last.framesApplied) / seconds,
+		(stats.bytesReceived - last.bytesReceived) / seconds,
+		(unsigned long long)stats.framesInvalid,
+		(unsigned long long)stats.framesLost);
+}
+
+int main(int argc, char** argv)
+{
+	EmulatorOptions options;
+
+	if (!ParseOptions(argc, argv, options))
+		return 1;
+
+	// open the pseudo terminal, the slave end stays open so the host can open and close it freely
+
+	int master, slave;
+	char portName[256];
+
+	if (openpty(&master, &slave, portName, nullptr, nullptr) != 0)
+	{
+		std::perror("openpty");
+		return 1;
+	}
+
+	termios settings;
+	tcgetattr(slave, &settings);
+	cfmakeraw(&settings);
+	tcsetattr(slave, TCSANOW, &settings);
+
+	fcntl(master, F_SETFL, fcntl(master, F_GETFL) | O_NONBLOCK);
+
+	std::signal(SIGINT, OnSignal);
+
+	std::printf("Macro pad emulator on %s (%u leds, max %u baud)\n", portName, options.numLeds, options.maxBaudRate);
+	std::fflush(stdout);
+
+	LedFrameDecoder decoder(options.numLeds);
+	EmulatorStats stats, lastStats;
+	bool hasSequence = false;
+	uint8_t expectedSequence = 0;
+
+	// the knob commands go after the button ones
+
+	std::vector<std::string> commandNames = options.commands;
+	size_t subirCommand = commandNames.size();
+	commandNames.push_back("Subir");
+	commandNames.push_back("Bajar");
+
+	uint32_t supportedFrameTypes = g_supportedFrameTypes;
+	bool commandIds = false;
+
+	if (!options.commandIds)
+		supportedFrameTypes &= ~(1u << (int)LedFrameType::CommandIds);
+
+	auto onFrame = [&](const LedFrameDecoder::Frame& frame) {
+		switch (frame.type)
+		{
+		case LedFrameType::Hello:
+			stats.controlFrames++;
+			WriteLine(master, "CAPS " + std::to_string(options.numLeds) + " " + std::to_string(supportedFrameTypes) + " " + std::to_string(options.maxBaudRate) + " " + std::to_string(Micros()) + " " + std::to_string(frame.sequence));
+			break;
+		case LedFrameType::CommandIds:
+			if (options.commandIds)
+			{
+				std::string line = "CMDS";
+
+				for (size_t i = 0; i < commandNames.size(); i++)
+					line += " " + std::to_string(i) + " " + commandNames[i];
+
+				stats.controlFrames++;
+				commandIds = WriteLine(master, line);
+			}
+			break;
+		case LedFrameType::SetBaud:
+			if (frame.size == 4)
+			{
+				// the pseudo terminal has no real rate, just confirm it
+
+				uint32_t baudRate = frame.payload[0] | (frame.payload[1] << 8) | (frame.payload[2] << 16) | ((uint32_t)frame.payload[3] << 24);
+				stats.controlFrames++;
+				WriteLine(master, "BAUD " + std::to_string(baudRate));
+			}
+			break;
+		default:
+			if (hasSequence && frame.sequence != expectedSequence)
+				stats.framesLost += (uint8_t)(frame.sequence - expectedSequence);
+
+			hasSequence = true;
+			expectedSequence = frame.sequence + 1;
+
+			if (decoder.Apply(frame))
+			{
+				stats.framesApplied++;
+
+				if (options.acknowledge)
+					WriteLine(master, "ACK " + std::to_string(frame.sequence));
+			}
+			else
+			{
+				stats.framesInvalid++;
+			}
+			break;
+		}
+	};
+
+	// command schedule
+
+	auto start = Clock::now();
+	auto nextBurst = start;
+	auto nextSpin = start;
+	auto nextStats = start + std::chrono::seconds(1);
+	auto burstInterval = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(options.rate > 0.0 ? 1.0 / options.rate : 0.0));
+	auto spinInterval = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(options.knobSpins > 0.0 ? 1.0 / options.knobSpins : 0.0));
+	size_t commandIndex = 0;
+	bool spinUp = true;
+
+	uint8_t buffer[4096];
+
+	while (g_running)
+	{
+		// wait for led frames until the next thing to send
+
+		pollfd pollFd = { master, POLLIN, 0 };
+		poll(&pollFd, 1, 1);
+
+		ssize_t bytesRead;
+
+		while ((bytesRead = read(master, buffer, sizeof(buffer))) > 0)
+		{
+			stats.bytesReceived += bytesRead;
+			decoder.Feed(buffer, bytesRead, onFrame);
+		}
+
+		auto now = Clock::now();
+
+		// command bursts
+
+		if (options.rate > 0.0 && !options.commands.empty())
+		{
+			while (now >= nextBurst)
+			{
+				for (uint32_t i = 0; i < options.burst; i++)
+				{
+					if (WriteEvent(master, commandNames, commandIndex++ % options.commands.size(), commandIds))
+						stats.commandsSent++;
+					else
+						stats.commandsDropped++;
+				}
+
+				nextBurst += burstInterval;
+			}
+		}
+
+		// knob spins, alternating the direction
+
+		if (options.knobSpins > 0.0)
+		{
+			while (now >= nextSpin)
+			{
+				for (uint32_t i = 0; i < options.knobSteps; i++)
+				{
+					if (WriteEvent(master, commandNames, spinUp ? subirCommand : subirCommand + 1, commandIds))
+						stats.commandsSent++;
+					else
+						stats.commandsDropped++;
+				}
+
+				spinUp = !spinUp;
+				nextSpin += spinInterval;
+			}
+		}
+
+		// stats every second
+
+		if (now >= nextStats)
+		{
+			PrintStats(stats, lastStats, 1.0);
+			lastStats = stats;
+			nextStats += std::chrono::seconds(1);
+		}
+
+		if (options.duration > 0.0 && now - start >= std::chrono::duration<double>(options.duration))
+			break;
+	}
+
+	// summary
+
+	double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+	std::printf("\nTotal: %.1f s, %llu commands (%llu dropped), %llu frames applied, %llu invalid, %llu lost, %llu crc errors, %llu control frames\n",
+		seconds,
+		(unsigned long long)stats.commandsSent,
+		(unsigned long long)stats.commandsDropped,
+		(unsigned long long)stats.framesApplied,
+		(unsigned long long)stats.framesInvalid,
+		(unsigned long long)stats.framesLost,
+		(unsigned long long)decoder.GetCrcErrors(),
+		(unsigned long long)stats.controlFrames);
+
+	close(slave);
+	close(master);
+
+	return 0;
+}